@@ -0,0 +1,133 @@
+#include "alloc_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <malloc.h>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+
+struct PhaseStats {
+    std::string name;
+    size_t entered, allocations, bytes;
+    int64_t peak, live_after;
+};
+
+std::atomic<bool> enabled{false};
+std::atomic<size_t> allocations{0}, allocated_bytes{0};
+std::atomic<int64_t> live_bytes{0}, peak_bytes{0};
+
+std::mutex phases_lock;
+std::vector<PhaseStats> phases;
+
+void raise_peak(int64_t bytes) {
+    int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+    while (bytes > peak && !peak_bytes.compare_exchange_weak(
+                               peak, bytes, std::memory_order_relaxed)) {
+    }
+}
+
+void count_allocation(void *ptr) {
+    const size_t size = malloc_usable_size(ptr);
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    raise_peak(live_bytes.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+void count_free(void *ptr) {
+    live_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+}
+
+void print_at_exit() { print_alloc_stats(std::cerr); }
+
+} // namespace
+
+void *operator new(size_t size) {
+    for (;;) {
+        void *res = std::malloc(size ? size : 1);
+        if (res) {
+            if (enabled.load(std::memory_order_relaxed)) {
+                count_allocation(res);
+            }
+            return res;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void *ptr) noexcept {
+    if (ptr && enabled.load(std::memory_order_relaxed)) {
+        count_free(ptr);
+    }
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+void enable_alloc_stats() {
+    if (!enabled.exchange(true)) {
+        std::atexit(print_at_exit);
+    }
+}
+
+bool alloc_stats_enabled() { return enabled; }
+
+AllocPhase::AllocPhase(const char *name)
+    : name_(name), running_(enabled), allocations_(allocations),
+      bytes_(allocated_bytes), outer_peak_(0) {
+    if (running_) {
+        outer_peak_ = peak_bytes.exchange(live_bytes);
+    }
+}
+
+void AllocPhase::end() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+
+    const int64_t peak = peak_bytes;
+    raise_peak(outer_peak_);
+    PhaseStats stats{name_, 1, allocations - allocations_,
+                     allocated_bytes - bytes_, peak, live_bytes};
+
+    std::lock_guard<std::mutex> lock(phases_lock);
+    for (auto &phase : phases) {
+        if (phase.name == stats.name) {
+            ++phase.entered;
+            phase.allocations += stats.allocations;
+            phase.bytes += stats.bytes;
+            phase.peak = std::max(phase.peak, stats.peak);
+            phase.live_after = stats.live_after;
+            return;
+        }
+    }
+    phases.push_back(std::move(stats));
+}
+
+void print_alloc_stats(std::ostream &output) {
+    std::lock_guard<std::mutex> lock(phases_lock);
+    output << std::left << std::setw(24) << "phase" << std::right
+           << std::setw(8) << "times" << std::setw(14) << "allocations"
+           << std::setw(16) << "bytes" << std::setw(16) << "peak live"
+           << std::setw(16) << "live after" << "\n";
+    for (const auto &phase : phases) {
+        output << std::left << std::setw(24) << phase.name << std::right
+               << std::setw(8) << phase.entered << std::setw(14)
+               << phase.allocations << std::setw(16) << phase.bytes
+               << std::setw(16) << phase.peak << std::setw(16)
+               << phase.live_after << "\n";
+    }
+    output << std::left << std::setw(24) << "total" << std::right
+           << std::setw(8) << "" << std::setw(14) << allocations
+           << std::setw(16) << allocated_bytes << std::setw(16) << peak_bytes
+           << std::setw(16) << live_bytes << "\n";
+}
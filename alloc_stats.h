@@ -0,0 +1,48 @@
+#ifndef __ALLOC_STATS_H
+#define __ALLOC_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/**
+ * Opt-in accounting of the heap. Once enabled, the global operator new and
+ * operator delete count the allocations, their bytes (as malloc reserves
+ * them) and the bytes live at once; the phases of the program measured with
+ * AllocPhase are printed to stderr when it exits. Until then the operators
+ * only check a flag. Enabling it first thing keeps the live bytes right:
+ * freeing what was allocated before lowers them all the same.
+ */
+void enable_alloc_stats();
+
+bool alloc_stats_enabled();
+
+/**
+ * Measures the allocations from its construction until end() or its
+ * destruction. Phases of the same name add up, and may be nested: the outer
+ * phase counts the allocations of the inner ones too.
+ */
+class AllocPhase {
+  public:
+    explicit AllocPhase(const char *name);
+
+    ~AllocPhase() { end(); }
+
+    AllocPhase(const AllocPhase &) = delete;
+    AllocPhase &operator=(const AllocPhase &) = delete;
+
+    void end();
+
+  private:
+    const char *name_;
+    bool running_;
+    size_t allocations_, bytes_;
+    // the peak of the enclosing phase, restored when this one ends
+    int64_t outer_peak_;
+};
+
+// the phases in the order they were first entered
+void print_alloc_stats(std::ostream &output);
+
+#endif
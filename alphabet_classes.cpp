@@ -0,0 +1,177 @@
+#include "alphabet_classes.h"
+
+#include <cassert>
+#include <map>
+#include <set>
+
+namespace {
+
+// a transition with the letters and states replaced by their ids
+struct IndexedTransition {
+    size_t state, target;
+    std::vector<size_t> read, written;
+    std::string moves;
+};
+
+/**
+ * Whether every transition of input has its counterpart in the quotient,
+ * and there is no other: each transition of the quotient stands for all
+ * the combinations of the letters of the classes it reads
+ */
+bool is_quotient(
+    const TuringMachine &input, const transitions_t &quotient,
+    const std::unordered_map<std::string, std::string> &representative) {
+    std::unordered_map<std::string, size_t> class_sizes;
+    for (const auto &[letter, letter_class] : representative) {
+        ++class_sizes[letter_class];
+    }
+
+    size_t combinations = 0;
+    for (const auto &[key, target] : quotient) {
+        size_t product = 1;
+        for (const auto &letter : key.second) {
+            product *= class_sizes.at(letter);
+        }
+        combinations += product;
+    }
+    if (combinations != input.transitions().size()) {
+        return false;
+    }
+
+    for (const auto &[key, target] : input.transitions()) {
+        std::vector<std::string> read, written;
+        for (const auto &letter : key.second) {
+            read.push_back(representative.at(letter));
+        }
+        for (const auto &letter : std::get<1>(target)) {
+            written.push_back(representative.at(letter));
+        }
+        const auto it = quotient.find(std::make_pair(key.first, read));
+        if (it == quotient.end() ||
+            it->second != std::make_tuple(std::get<0>(target), written,
+                                          std::get<2>(target))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+AlphabetClasses compute_alphabet_classes(const TuringMachine &input) {
+    const TuringMachineIndex &index = input.index();
+    const auto &alphabet = index.working_alphabet;
+    const size_t num_tapes = input.num_tapes;
+
+    std::vector<IndexedTransition> transitions;
+    transitions.reserve(input.transitions().size());
+    for (const auto &[key, target] : input.transitions()) {
+        IndexedTransition transition{index.state_ids.at(key.first),
+                                     index.state_ids.at(std::get<0>(target)),
+                                     {},
+                                     {},
+                                     std::get<2>(target)};
+        for (const auto &letter : key.second) {
+            transition.read.push_back(index.letter_ids.at(letter));
+        }
+        for (const auto &letter : std::get<1>(target)) {
+            transition.written.push_back(index.letter_ids.at(letter));
+        }
+        transitions.push_back(std::move(transition));
+    }
+
+    // the class of each letter, by the letter ids
+    std::vector<size_t> classes(alphabet.size());
+    size_t num_classes = 0;
+    for (size_t a = 0; a < alphabet.size(); ++a) {
+        classes[a] = alphabet[a] == BLANK ? 0 : 1;
+        num_classes = std::max(num_classes, classes[a] + 1);
+    }
+
+    for (;;) {
+        /**
+         * what a letter does when read by one of the heads: the tape, the
+         * state, the exact letters read by the other heads, and the target
+         * with the written letters known only up to their classes
+         */
+        std::vector<std::set<std::vector<size_t>>> signatures(alphabet.size());
+        for (const auto &transition : transitions) {
+            std::vector<size_t> target{transition.target};
+            for (size_t letter : transition.written) {
+                target.push_back(classes[letter]);
+            }
+            for (char move : transition.moves) {
+                target.push_back(move);
+            }
+
+            for (size_t a = 0; a < num_tapes; ++a) {
+                std::vector<size_t> entry{a, transition.state};
+                for (size_t b = 0; b < num_tapes; ++b) {
+                    entry.push_back(a == b ? SIZE_MAX : transition.read[b]);
+                }
+                entry.insert(entry.end(), target.begin(), target.end());
+                signatures[transition.read[a]].insert(std::move(entry));
+            }
+        }
+
+        std::map<std::pair<size_t, std::set<std::vector<size_t>>>, size_t>
+            refined;
+        for (size_t a = 0; a < alphabet.size(); ++a) {
+            const size_t next = refined.size();
+            classes[a] =
+                refined
+                    .emplace(std::make_pair(classes[a], std::move(signatures[a])),
+                             next)
+                    .first->second;
+        }
+        if (refined.size() == num_classes) {
+            break;
+        }
+        num_classes = refined.size();
+    }
+
+    std::unordered_map<std::string, std::string> representative;
+
+    // the alphabet is sorted, so the first letter met is the smallest
+    std::vector<size_t> representatives(num_classes, SIZE_MAX);
+    for (size_t a = 0; a < alphabet.size(); ++a) {
+        if (representatives[classes[a]] == SIZE_MAX) {
+            representatives[classes[a]] = a;
+        }
+        representative[alphabet[a]] =
+            alphabet[representatives[classes[a]]];
+    }
+
+    std::vector<std::string> input_alphabet;
+    std::set<std::string> seen;
+    for (const auto &letter : input.input_alphabet()) {
+        const auto &letter_class = representative.at(letter);
+        if (seen.insert(letter_class).second) {
+            input_alphabet.push_back(letter_class);
+        }
+    }
+
+    transitions_t quotient_transitions;
+    for (const auto &[key, target] : input.transitions()) {
+        std::vector<std::string> read, written;
+        for (const auto &letter : key.second) {
+            read.push_back(representative.at(letter));
+        }
+        if (read != key.second) {
+            continue;
+        }
+        for (const auto &letter : std::get<1>(target)) {
+            written.push_back(representative.at(letter));
+        }
+        quotient_transitions[key] =
+            std::make_tuple(std::get<0>(target), std::move(written),
+                            std::get<2>(target));
+    }
+
+    assert(is_quotient(input, quotient_transitions, representative));
+
+    return AlphabetClasses{TuringMachine(input.num_tapes,
+                                         std::move(input_alphabet),
+                                         std::move(quotient_transitions)),
+                           std::move(representative)};
+}
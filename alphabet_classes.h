@@ -0,0 +1,32 @@
+#ifndef __ALPHABET_CLASSES_H
+#define __ALPHABET_CLASSES_H
+
+#include <string>
+#include <unordered_map>
+
+#include "turing_machine.h"
+
+struct AlphabetClasses {
+    // the same machine over one letter of each class, the smallest one;
+    // its input alphabet are the letters standing for the input letters
+    TuringMachine quotient;
+
+    // for each letter of the working alphabet, the letter of its class
+    std::unordered_map<std::string, std::string> representative;
+};
+
+/**
+ * Divides the working alphabet into classes of letters interchangeable in
+ * every transition: with the other tapes reading the same letters, reading
+ * any letter of a class leads to the same state, writing letters of the same
+ * classes and moving the heads the same way. Replacing every letter by the
+ * letter of its class does not change what the machine accepts, so the
+ * quotient can be translated instead.
+ *
+ * The classes are refined from {blank} and all the other letters until
+ * no transition tells two letters of a class apart, as in minimizing
+ * an automaton; the blank is always alone, as it fills the unvisited cells.
+ */
+AlphabetClasses compute_alphabet_classes(const TuringMachine &input);
+
+#endif
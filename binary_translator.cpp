@@ -0,0 +1,438 @@
+#include "binary_translator.h"
+
+#include <cassert>
+
+BinaryTranslation::BinaryTranslation(const TuringMachine &input)
+    : input_(input),
+      // we cannot allow for those identifiers to be generated
+      states_(std::vector<std::string>{INITIAL_STATE, ACCEPTING_STATE,
+                                       REJECTING_STATE}),
+      letters_(input.working_alphabet()), bits_(1) {
+    assert(input.num_tapes == 2);
+
+    // the blank is all zeros, so that new blocks are filled with zeros
+    codes_[BLANK] = 0;
+    for (const Letter &letter : input_.working_alphabet()) {
+        if (letter != BLANK) {
+            const size_t code = codes_.size();
+            codes_[letter] = code;
+        }
+    }
+    while ((size_t{1} << bits_) < codes_.size()) {
+        ++bits_;
+    }
+
+    for (const auto &[key, target] : input_.transitions()) {
+        by_codes_[key.first][codes_.at(key.second[0])]
+                 [codes_.at(key.second[1])] = &target;
+    }
+
+    tape_start_ = letters_.generate("tape-start");
+    consumed_ = letters_.generate("consumed");
+    zero_ = letters_.generate("bit-0");
+    one_ = letters_.generate("bit-1");
+    separators_[0] = letters_.generate("cell");
+    separators_[TOP] = letters_.generate("cell-top");
+    separators_[BOTTOM] = letters_.generate("cell-bottom");
+    separators_[TOP | BOTTOM] = letters_.generate("cell-both");
+
+    program_setup_();
+}
+
+TuringMachine BinaryTranslation::result() {
+    return TuringMachine(1, input_.input_alphabet(),
+                         std::move(res_transitions_));
+}
+
+/**
+ * The input letters are consumed from the left, each one carried right past
+ * the blocks made so far and written as a new block there; the consumed
+ * cells stay left of the start of the simulated tapes, never visited again
+ */
+void BinaryTranslation::program_setup_() {
+    const std::string blank_bits = pattern_(0);
+
+    // special case for empty input (head is over blank)
+    new_transition_(INITIAL_STATE, BLANK,
+                    placing_block_(TOP | BOTTOM, 0, returning_(INITIAL_STATE)),
+                    tape_start_, HEAD_RIGHT);
+
+    const State back_to_consumed = states_.generate("setup-back");
+    const State next_letter = states_.generate("setup-next");
+
+    for (const Letter &letter : input_.input_alphabet()) {
+        const State carrying_first = states_.generate("setup-carry-1st-" + letter);
+        const State carrying = states_.generate("setup-carry-" + letter);
+        const size_t code = codes_.at(letter);
+
+        new_transition_(INITIAL_STATE, letter, carrying_first, consumed_,
+                        HEAD_RIGHT);
+        new_transition_(next_letter, letter, carrying, consumed_, HEAD_RIGHT);
+
+        for (const Letter &other_letter : input_.input_alphabet()) {
+            new_transition_(carrying_first, other_letter, carrying_first,
+                            other_letter, HEAD_RIGHT);
+            new_transition_(carrying, other_letter, carrying, other_letter,
+                            HEAD_RIGHT);
+        }
+        new_transition_(carrying_first, BLANK,
+                        placing_block_(TOP | BOTTOM, code, back_to_consumed),
+                        tape_start_, HEAD_RIGHT);
+
+        new_transition_(carrying, tape_start_, carrying, tape_start_,
+                        HEAD_RIGHT);
+        for (const Letter &separator : separators_) {
+            new_transition_(carrying, separator, carrying, separator,
+                            HEAD_RIGHT);
+        }
+        for (const Letter &bit : {zero_, one_}) {
+            new_transition_(carrying, bit, carrying, bit, HEAD_RIGHT);
+        }
+        new_transition_(carrying, BLANK,
+                        filling_(pattern_(code) + blank_bits, back_to_consumed),
+                        separators_[0], HEAD_RIGHT);
+    }
+
+    for (const Letter &letter : input_.input_alphabet()) {
+        new_transition_(back_to_consumed, letter, back_to_consumed, letter,
+                        HEAD_LEFT);
+    }
+    new_transition_(back_to_consumed, tape_start_, back_to_consumed,
+                    tape_start_, HEAD_LEFT);
+    for (const Letter &separator : separators_) {
+        new_transition_(back_to_consumed, separator, back_to_consumed,
+                        separator, HEAD_LEFT);
+    }
+    for (const Letter &bit : {zero_, one_}) {
+        new_transition_(back_to_consumed, bit, back_to_consumed, bit,
+                        HEAD_LEFT);
+    }
+    new_transition_(back_to_consumed, consumed_, next_letter, consumed_,
+                    HEAD_RIGHT);
+
+    // the whole input is in blocks
+    new_transition_(next_letter, tape_start_, start_scanning_(INITIAL_STATE),
+                    tape_start_, HEAD_RIGHT);
+}
+
+BinaryTranslation::State BinaryTranslation::returning_(const State &state) {
+    if (state == ACCEPTING_STATE || state == REJECTING_STATE) {
+        return state;
+    }
+    return sweeping_back_(start_scanning_(state));
+}
+
+BinaryTranslation::State
+BinaryTranslation::start_scanning_(const State &state) {
+    return scanning_for_(TOP, reading_top_(state, 0, 0));
+}
+
+BinaryTranslation::State BinaryTranslation::reading_top_(const State &state,
+                                                         size_t depth,
+                                                         size_t prefix) {
+    State res;
+    if (!make_state_("read-top", state, depth, prefix, res)) {
+        return res;
+    }
+
+    // no transition for the letters read so far leaves the machine halted
+    const auto state_it = by_codes_.find(state);
+    if (state_it == by_codes_.end()) {
+        return res;
+    }
+    const auto &by_top_code = state_it->second;
+
+    for (size_t bit = 0; bit < 2; ++bit) {
+        const size_t code = 2 * prefix + bit;
+        const size_t remaining = bits_ - depth - 1;
+        const auto it = by_top_code.lower_bound(code << remaining);
+        if (it == by_top_code.end() || it->first >= (code + 1) << remaining) {
+            continue;
+        }
+
+        if (remaining) {
+            new_transition_(res, bit_(bit), reading_top_(state, depth + 1, code),
+                            bit_(bit), HEAD_RIGHT);
+        } else {
+            new_transition_(
+                res, bit_(bit),
+                sweeping_back_(scanning_for_(
+                    BOTTOM, skipping_bits_(
+                                bits_, reading_bottom_(state, code, 0, 0)))),
+                bit_(bit), HEAD_LEFT);
+        }
+    }
+    return res;
+}
+
+BinaryTranslation::State
+BinaryTranslation::reading_bottom_(const State &state, size_t top_code,
+                                   size_t depth, size_t prefix) {
+    State res;
+    if (!make_state_("read-bottom", state + " " + std::to_string(top_code),
+                     depth, prefix, res)) {
+        return res;
+    }
+
+    const auto &by_bottom_code = by_codes_.at(state).at(top_code);
+    for (size_t bit = 0; bit < 2; ++bit) {
+        const size_t code = 2 * prefix + bit;
+        const size_t remaining = bits_ - depth - 1;
+        const auto it = by_bottom_code.lower_bound(code << remaining);
+        if (it == by_bottom_code.end() || it->first >= (code + 1) << remaining) {
+            continue;
+        }
+
+        if (remaining) {
+            new_transition_(res, bit_(bit),
+                            reading_bottom_(state, top_code, depth + 1, code),
+                            bit_(bit), HEAD_RIGHT);
+        } else {
+            // the last bit of the new bottom letter is written right away
+            const auto &target = *it->second;
+            const size_t new_code = codes_.at(std::get<1>(target)[1]);
+            new_transition_(res, bit_(bit), applying_(target, top_code),
+                            bit_(code_bit_(new_code, bits_)), HEAD_LEFT);
+        }
+    }
+    return res;
+}
+
+BinaryTranslation::State
+BinaryTranslation::applying_(const transitions_t::mapped_type &target,
+                             size_t top_code) {
+    const State &target_state = std::get<0>(target);
+    const size_t new_top_code = codes_.at(std::get<1>(target)[0]);
+    const size_t new_bottom_code = codes_.at(std::get<1>(target)[1]);
+    const char top_move = std::get<2>(target)[0];
+    const char bottom_move = std::get<2>(target)[1];
+
+    // the top head is visited again only if there is anything to change
+    State top_done = returning_(target_state);
+    if (new_top_code != top_code || top_move != HEAD_STAY) {
+        top_done = sweeping_back_(scanning_for_(
+            TOP, writing_right_(
+                     pattern_(new_top_code),
+                     seeking_separator_(
+                         moving_head_(TOP, top_move, top_done)))));
+    }
+
+    // the rest of the bottom letter, from its last but one bit
+    std::string bottom_bits = pattern_(new_bottom_code);
+    bottom_bits.pop_back();
+    return writing_left_(
+        std::string(bottom_bits.rbegin(), bottom_bits.rend()),
+        seeking_separator_(moving_head_(BOTTOM, bottom_move, top_done)));
+}
+
+BinaryTranslation::State BinaryTranslation::sweeping_back_(const State &next) {
+    State res;
+    if (!make_state_("sweep-back", next, 0, 0, res)) {
+        return res;
+    }
+
+    for (const Letter &separator : separators_) {
+        new_transition_(res, separator, res, separator, HEAD_LEFT);
+    }
+    for (const Letter &bit : {zero_, one_}) {
+        new_transition_(res, bit, res, bit, HEAD_LEFT);
+    }
+    new_transition_(res, tape_start_, next, tape_start_, HEAD_RIGHT);
+    return res;
+}
+
+BinaryTranslation::State BinaryTranslation::scanning_for_(int head,
+                                                          const State &next) {
+    State res;
+    if (!make_state_(head == TOP ? "scan-top" : "scan-bottom", next, 0, 0,
+                     res)) {
+        return res;
+    }
+
+    for (int heads = 0; heads < 4; ++heads) {
+        new_transition_(res, separators_[heads], heads & head ? next : res,
+                        separators_[heads], HEAD_RIGHT);
+    }
+    for (const Letter &bit : {zero_, one_}) {
+        new_transition_(res, bit, res, bit, HEAD_RIGHT);
+    }
+    return res;
+}
+
+BinaryTranslation::State BinaryTranslation::skipping_bits_(size_t count,
+                                                           const State &next) {
+    if (!count) {
+        return next;
+    }
+    State res;
+    if (!make_state_("skip", next, count, 0, res)) {
+        return res;
+    }
+
+    const State after = skipping_bits_(count - 1, next);
+    for (const Letter &bit : {zero_, one_}) {
+        new_transition_(res, bit, after, bit, HEAD_RIGHT);
+    }
+    return res;
+}
+
+BinaryTranslation::State
+BinaryTranslation::writing_right_(const std::string &pattern,
+                                  const State &next) {
+    if (pattern.empty()) {
+        return next;
+    }
+    State res;
+    if (!make_state_("write-right", pattern + " " + next, 0, 0, res)) {
+        return res;
+    }
+
+    const State after = writing_right_(pattern.substr(1), next);
+    for (const Letter &bit : {zero_, one_}) {
+        new_transition_(res, bit, after, bit_(pattern[0] == '1'),
+                        pattern.size() == 1 ? HEAD_LEFT : HEAD_RIGHT);
+    }
+    return res;
+}
+
+BinaryTranslation::State
+BinaryTranslation::writing_left_(const std::string &pattern,
+                                 const State &next) {
+    if (pattern.empty()) {
+        return next;
+    }
+    State res;
+    if (!make_state_("write-left", pattern + " " + next, 0, 0, res)) {
+        return res;
+    }
+
+    const State after = writing_left_(pattern.substr(1), next);
+    for (const Letter &bit : {zero_, one_}) {
+        new_transition_(res, bit, after, bit_(pattern[0] == '1'), HEAD_LEFT);
+    }
+    return res;
+}
+
+BinaryTranslation::State BinaryTranslation::filling_(const std::string &pattern,
+                                                     const State &next) {
+    if (pattern.empty()) {
+        return next;
+    }
+    State res;
+    if (!make_state_("fill", pattern + " " + next, 0, 0, res)) {
+        return res;
+    }
+
+    new_transition_(res, BLANK, filling_(pattern.substr(1), next),
+                    bit_(pattern[0] == '1'),
+                    pattern.size() == 1 ? HEAD_LEFT : HEAD_RIGHT);
+    return res;
+}
+
+BinaryTranslation::State
+BinaryTranslation::seeking_separator_(const State &next) {
+    State res;
+    if (!make_state_("seek-cell", next, 0, 0, res)) {
+        return res;
+    }
+
+    for (const Letter &bit : {zero_, one_}) {
+        new_transition_(res, bit, res, bit, HEAD_LEFT);
+    }
+    for (const Letter &separator : separators_) {
+        new_transition_(res, separator, next, separator, HEAD_STAY);
+    }
+    return res;
+}
+
+BinaryTranslation::State BinaryTranslation::moving_head_(int head, char move,
+                                                         const State &next) {
+    State res;
+    if (!make_state_(head == TOP ? "move-top" : "move-bottom", next, move, 0,
+                     res)) {
+        return res;
+    }
+
+    if (move == HEAD_STAY) {
+        for (int heads = 0; heads < 4; ++heads) {
+            if (heads & head) {
+                new_transition_(res, separators_[heads], next,
+                                separators_[heads], HEAD_LEFT);
+            }
+        }
+        return res;
+    }
+
+    // over the bits to the separator of the next or the previous cell
+    State moved;
+    make_state_(head == TOP ? "moving-top" : "moving-bottom", next, move, 0,
+                moved);
+    for (int heads = 0; heads < 4; ++heads) {
+        if (heads & head) {
+            new_transition_(res, separators_[heads], moved,
+                            separators_[heads & ~head], move);
+        }
+        new_transition_(moved, separators_[heads], next,
+                        separators_[heads | head], HEAD_LEFT);
+    }
+    for (const Letter &bit : {zero_, one_}) {
+        new_transition_(moved, bit, moved, bit, move);
+    }
+
+    if (move == HEAD_RIGHT) {
+        // a cell not visited before
+        new_transition_(moved, BLANK, filling_(pattern_(0) + pattern_(0), next),
+                        separators_[head], HEAD_RIGHT);
+    } else {
+        // the head falls off the tape
+        new_transition_(moved, tape_start_, REJECTING_STATE, tape_start_,
+                        HEAD_STAY);
+    }
+    return res;
+}
+
+BinaryTranslation::State BinaryTranslation::placing_block_(int heads,
+                                                           size_t code,
+                                                           const State &next) {
+    State res;
+    if (!make_state_("place", next, heads, code, res)) {
+        return res;
+    }
+
+    new_transition_(res, BLANK, filling_(pattern_(code) + pattern_(0), next),
+                    separators_[heads], HEAD_RIGHT);
+    return res;
+}
+
+std::string BinaryTranslation::pattern_(size_t code) const {
+    std::string res;
+    for (size_t position = 1; position <= bits_; ++position) {
+        res += code_bit_(code, position) ? '1' : '0';
+    }
+    return res;
+}
+
+bool BinaryTranslation::make_state_(const std::string &kind,
+                                    const std::string &text, size_t first,
+                                    size_t second, State &res) {
+    const auto [it, inserted] = states_made_.emplace(
+        std::make_tuple(kind, text, first, second), State());
+    if (inserted) {
+        it->second = states_.generate(kind);
+    }
+    res = it->second;
+    return inserted;
+}
+
+void BinaryTranslation::new_transition_(const State &initial,
+                                        const Letter &old_letter,
+                                        const State &final,
+                                        const Letter &new_letter,
+                                        char head_move) {
+    const auto key = std::make_pair(initial, std::vector{old_letter});
+
+    assert(res_transitions_.find(key) == res_transitions_.end());
+
+    res_transitions_[key] =
+        std::make_tuple(final, std::vector{new_letter}, std::string{head_move});
+}
@@ -0,0 +1,142 @@
+#ifndef __BINARY_TRANSLATOR_H
+#define __BINARY_TRANSLATOR_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "symbol_set.h"
+#include "turing_machine.h"
+
+/**
+ * Translates a 2-tape machine to a single tape one which keeps each cell of
+ * both tapes as a block of cells over a small alphabet: a separator telling
+ * which heads are over the cell, followed by the bits of the top letter and
+ * of the bottom letter (the blank being all zeros).
+ *
+ * Each simulated step sweeps from the start of the tape to the top head to
+ * read its letter, then to the bottom head, reading its letter and applying
+ * its part of the transition, and then once more to the top head to apply
+ * the rest. The letters read are followed bit by bit, only as far as some
+ * transition reads them, so the translated machine has
+ * O(|transitions| log |alphabet|) states and transitions, instead of the
+ * |alphabet|^2 letters and O(|states| |alphabet|^3) transitions of
+ * Translation. In exchange each simulated cell takes 1 + 2 log |alphabet|
+ * cells of the tape, and the setup, which spreads the input into blocks,
+ * takes time quadratic in its length.
+ */
+class BinaryTranslation {
+    typedef std::string State;
+    typedef std::string Letter;
+
+  public:
+    explicit BinaryTranslation(const TuringMachine &input);
+
+    // cells of the tape taken by each simulated cell
+    size_t block_width() const { return 1 + 2 * bits_; }
+
+    // moves the translated transitions out, so it can be taken only once
+    TuringMachine result();
+
+  private:
+    // the heads, as flags of a separator
+    static const int TOP = 1, BOTTOM = 2;
+
+    const Letter &bit_(bool one) const { return one ? one_ : zero_; }
+
+    // the bit at position (from 1, the most significant first) of code
+    bool code_bit_(size_t code, size_t position) const {
+        return (code >> (bits_ - position)) & 1;
+    }
+
+    void program_setup_();
+
+    // what a simulated state does, from the start of the tape;
+    // the halting states are their own
+    State returning_(const State &state);
+
+    State start_scanning_(const State &state);
+
+    // reads the letter of the top head, depth bits of which are prefix
+    State reading_top_(const State &state, size_t depth, size_t prefix);
+
+    State reading_bottom_(const State &state, size_t top_code, size_t depth,
+                          size_t prefix);
+
+    // the rest of the transition once both letters are read, from the
+    // last bottom bit which has just been written
+    State applying_(const transitions_t::mapped_type &target,
+                    size_t top_code);
+
+    // the sub-machines below lead to next once done
+
+    // left to the start of the tape, and right off it
+    State sweeping_back_(const State &next);
+
+    // right to the separator of head, and right off it
+    State scanning_for_(int head, const State &next);
+
+    State skipping_bits_(size_t count, const State &next);
+
+    // writes the bits of pattern, each one moving right but the last
+    State writing_right_(const std::string &pattern, const State &next);
+
+    // writes the bits of pattern, each one moving left
+    State writing_left_(const std::string &pattern, const State &next);
+
+    // writes the bits of pattern over the blanks, as writing_right_
+    State filling_(const std::string &pattern, const State &next);
+
+    // left over the bits to a separator, staying on it
+    State seeking_separator_(const State &next);
+
+    // from the separator of head, moves it; next is entered left of the
+    // separator the head ends at
+    State moving_head_(int head, char move, const State &next);
+
+    // writes a block for a new cell, with code as the top letter
+    State placing_block_(int heads, size_t code, const State &next);
+
+    // the bits of code, as the patterns above
+    std::string pattern_(size_t code) const;
+
+    /**
+     * Finds the state made with those parameters; if there is none yet,
+     * generates it and returns true, so that the caller programs it
+     */
+    bool make_state_(const std::string &kind, const std::string &text,
+                     size_t first, size_t second, State &res);
+
+    void new_transition_(const State &initial, const Letter &old_letter,
+                         const State &final, const Letter &new_letter,
+                         char head_move);
+
+    const TuringMachine &input_;
+    SymbolSet states_, letters_;
+
+    // bits of each letter
+    size_t bits_;
+    std::unordered_map<Letter, size_t> codes_;
+
+    // for each simulated state, the transitions by the codes of the top
+    // and the bottom letters they read
+    std::map<State,
+             std::map<size_t,
+                      std::map<size_t, const transitions_t::mapped_type *>>>
+        by_codes_;
+
+    Letter tape_start_, consumed_, zero_, one_;
+    // by the heads over the cell, a sum of TOP and BOTTOM
+    Letter separators_[4];
+
+    transitions_t res_transitions_;
+
+    // the states already programmed, by the parameters they were made for
+    std::map<std::tuple<std::string, std::string, size_t, size_t>, State>
+        states_made_;
+};
+
+#endif
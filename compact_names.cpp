@@ -0,0 +1,125 @@
+#include "compact_names.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+static const char DIGITS[] =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+
+static const size_t NUM_DIGITS = sizeof(DIGITS) - 1;
+
+// the n-th shortest identifier
+static std::string nth_identifier(size_t n) {
+    if (n < NUM_DIGITS) {
+        return std::string(1, DIGITS[n]);
+    }
+    n -= NUM_DIGITS;
+
+    size_t length = 1, count = NUM_DIGITS;
+    while (n >= count) {
+        n -= count;
+        ++length;
+        count *= NUM_DIGITS;
+    }
+
+    std::string res(length + 2, ')');
+    res[0] = '(';
+    for (size_t a = length; a > 0; --a) {
+        res[a] = DIGITS[n % NUM_DIGITS];
+        n /= NUM_DIGITS;
+    }
+    return res;
+}
+
+typedef std::unordered_map<std::string, std::string> Renaming;
+
+static Renaming compact(const std::unordered_map<std::string, size_t> &counts,
+                        const std::unordered_set<std::string> &fixed) {
+    std::vector<std::pair<size_t, std::string>> by_frequency;
+    for (const auto &[name, count] : counts) {
+        if (fixed.find(name) == fixed.end()) {
+            by_frequency.emplace_back(count, name);
+        }
+    }
+    std::sort(by_frequency.begin(), by_frequency.end(),
+              [](const auto &a, const auto &b) {
+                  return a.first != b.first ? a.first > b.first
+                                            : a.second < b.second;
+              });
+
+    Renaming res;
+    size_t next = 0;
+    for (const auto &[count, name] : by_frequency) {
+        std::string compact_name;
+        do {
+            compact_name = nth_identifier(next++);
+        } while (fixed.find(compact_name) != fixed.end());
+        res[name] = compact_name;
+    }
+    return res;
+}
+
+static const std::string &renamed(const Renaming &renaming,
+                                  const std::string &name) {
+    const auto it = renaming.find(name);
+    return it == renaming.end() ? name : it->second;
+}
+
+static void output_renaming(std::ostream &output, const Renaming &renaming) {
+    std::vector<std::pair<std::string, std::string>> sorted(renaming.begin(),
+                                                            renaming.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (const auto &[name, compact_name] : sorted) {
+        output << compact_name << " " << name << "\n";
+    }
+}
+
+TuringMachine compact_names(const TuringMachine &tm, std::ostream *names) {
+    std::unordered_map<std::string, size_t> state_counts, letter_counts;
+    for (const auto &[key, target] : tm.transitions()) {
+        ++state_counts[key.first];
+        ++state_counts[std::get<0>(target)];
+        for (const auto &letter : key.second) {
+            ++letter_counts[letter];
+        }
+        for (const auto &letter : std::get<1>(target)) {
+            ++letter_counts[letter];
+        }
+    }
+
+    std::unordered_set<std::string> fixed_letters(tm.input_alphabet().begin(),
+                                                  tm.input_alphabet().end());
+    fixed_letters.insert(BLANK);
+    const auto states = compact(
+        state_counts, {INITIAL_STATE, ACCEPTING_STATE, REJECTING_STATE});
+    const auto letters = compact(letter_counts, fixed_letters);
+
+    transitions_t transitions;
+    for (const auto &[key, target] : tm.transitions()) {
+        std::vector<std::string> letters_before, letters_after;
+        for (const auto &letter : key.second) {
+            letters_before.push_back(renamed(letters, letter));
+        }
+        for (const auto &letter : std::get<1>(target)) {
+            letters_after.push_back(renamed(letters, letter));
+        }
+        transitions.emplace(
+            std::make_pair(renamed(states, key.first),
+                           std::move(letters_before)),
+            std::make_tuple(renamed(states, std::get<0>(target)),
+                            std::move(letters_after), std::get<2>(target)));
+    }
+
+    if (names) {
+        *names << "# states\n";
+        output_renaming(*names, states);
+        *names << "# letters\n";
+        output_renaming(*names, letters);
+    }
+
+    // the alphabet belongs to tm, only the renamed transitions are moved
+    return TuringMachine(tm.num_tapes, tm.input_alphabet(),
+                         std::move(transitions));
+}
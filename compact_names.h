@@ -0,0 +1,18 @@
+#ifndef __COMPACT_NAMES_H
+#define __COMPACT_NAMES_H
+
+#include <iostream>
+
+#include "turing_machine.h"
+
+/**
+ * Renames the states and letters of a translated machine to the shortest
+ * valid identifiers: single characters first, then bracketed base-64 codes.
+ * The most frequent names get the shortest identifiers. The special states,
+ * the blank and the input letters keep their names.
+ * If names is not null, the mapping back to the original names is written
+ * there, one "<compact> <original>" pair per line.
+ */
+TuringMachine compact_names(const TuringMachine &tm, std::ostream *names);
+
+#endif
@@ -0,0 +1,93 @@
+#include "enumerator.h"
+
+using namespace std;
+
+namespace {
+
+class Enumeration {
+  public:
+    Enumeration(Run &run, const vector<string> &alphabet, size_t max_length,
+                size_t max_steps, const WordCallback &on_word)
+        : run_(run), alphabet_(alphabet), max_length_(max_length),
+          max_steps_(max_steps), on_word_(on_word) {
+        stats_.accepted.resize(max_length + 1);
+        stats_.rejected.resize(max_length + 1);
+        stats_.unknown.resize(max_length + 1);
+    }
+
+    EnumerationStats run() {
+        run_.open_input(0);
+        explore_();
+        return move(stats_);
+    }
+
+  private:
+    // runs the words starting with word_, the run being at its fork
+    void explore_() {
+        size_t from = run_.steps();
+        run_.run(max_steps_ - run_.steps());
+        stats_.steps += run_.steps() - from;
+        if (!run_.awaits_input()) {
+            report_subtree_();
+            return;
+        }
+
+        ++stats_.forks;
+        Run::Checkpoint fork = run_.checkpoint();
+        run_.close_input();
+        from = run_.steps();
+        run_.run(max_steps_ - run_.steps());
+        stats_.steps += run_.steps() - from;
+        report_();
+
+        if (word_.size() == max_length_)
+            return;
+        for (const auto &letter : alphabet_) {
+            run_.restore(fork);
+            run_.extend_input(letter);
+            word_.push_back(letter);
+            explore_();
+            word_.pop_back();
+        }
+    }
+
+    // the run halted, or was given up, without reading past word_,
+    // so every word starting with it ends the same way
+    void report_subtree_() {
+        report_();
+        if (word_.size() == max_length_)
+            return;
+        for (const auto &letter : alphabet_) {
+            word_.push_back(letter);
+            report_subtree_();
+            word_.pop_back();
+        }
+    }
+
+    void report_() {
+        Verdict verdict = run_.verdict();
+        if (verdict == Verdict::ACCEPT)
+            ++stats_.accepted[word_.size()];
+        else if (verdict == Verdict::REJECT)
+            ++stats_.rejected[word_.size()];
+        else
+            ++stats_.unknown[word_.size()];
+        stats_.separate_steps += run_.steps();
+        on_word_(word_, verdict);
+    }
+
+    Run &run_;
+    const vector<string> &alphabet_;
+    size_t max_length_, max_steps_;
+    const WordCallback &on_word_;
+    vector<string> word_;
+    EnumerationStats stats_;
+};
+
+} // namespace
+
+EnumerationStats enumerate_words(Run &run, const vector<string> &alphabet,
+                                 size_t max_length, size_t max_steps,
+                                 const WordCallback &on_word) {
+    return Enumeration(run, alphabet, max_length, max_steps, on_word).run();
+}
@@ -0,0 +1,46 @@
+#ifndef __ENUMERATOR_H
+#define __ENUMERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+
+struct EnumerationStats {
+    // the numbers of words, by their lengths
+    std::vector<size_t> accepted, rejected, unknown;
+    // steps executed by the shared runs
+    size_t steps = 0;
+    // steps a separate run of each word would have executed
+    size_t separate_steps = 0;
+    // configurations forked on reading an undetermined input cell
+    size_t forks = 0;
+};
+
+// the verdict is RUNNING for the words whose runs were given up
+typedef std::function<void(const std::vector<std::string> &word, Verdict)>
+    WordCallback;
+
+/**
+ * Runs the machine on every word over the alphabet of at most max_length
+ * letters, walking the trie of the words. The words of a subtree share
+ * the run of their prefix as long as the first head stays within it; when
+ * it reaches the first undetermined cell the configuration is forked
+ * (the tapes are cloned, which SharedTape makes copy-on-write) into the
+ * word ending there and one extension by each letter. A run which halts
+ * before gives the verdict of the whole subtree at once.
+ *
+ * run is the run of the machine on the empty word, not started yet; a word
+ * is given up after max_steps steps, counting those of its prefixes.
+ * on_word is called for each word before its extensions, which come in the
+ * order of the alphabet.
+ */
+EnumerationStats enumerate_words(Run &run,
+                                 const std::vector<std::string> &alphabet,
+                                 size_t max_length, size_t max_steps,
+                                 const WordCallback &on_word);
+
+#endif
@@ -0,0 +1,124 @@
+#include "input_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// stdin is read in chunks of this size
+#define CHUNK (1 << 20)
+
+static bool is_whitespace(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+InputFile::InputFile(const string &filename,
+                     const vector<string> &input_alphabet)
+    : fd_(filename == "-" ? STDIN_FILENO : open(filename.c_str(), O_RDONLY)),
+      input_alphabet_(input_alphabet), invalid_(false) {}
+
+InputFile::~InputFile() {
+    if (fd_ > STDIN_FILENO)
+        close(fd_);
+}
+
+size_t InputFile::write(LetterTable &letters, Tape &tape) {
+    fill(begin(single_char_letters_), end(single_char_letters_), NOT_A_LETTER);
+    for (const auto &letter : input_alphabet_) {
+        if (letter.length() == 1)
+            single_char_letters_[(unsigned char)letter[0]] = letters.id(letter);
+        else
+            bracketed_letters_[letter] = letters.id(letter);
+    }
+
+    size_t pos = 0;
+    struct stat info;
+    if (fstat(fd_, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, info.st_size, MADV_SEQUENTIAL);
+            const char *chars = (const char *)data;
+            size_t size = info.st_size, sample = min<size_t>(size, CHUNK);
+            size_t used = tokenize_(chars, sample, sample == size, tape, pos);
+            // the rest is assumed to have as many letters per byte as the
+            // start, which long bracketed letters make far fewer than one
+            if (!invalid_ && used < size) {
+                if (used)
+                    tape.reserve((double)pos / used * size);
+                tokenize_(chars + used, size - used, true, tape, pos);
+            }
+            munmap(data, info.st_size);
+            return pos;
+        }
+    }
+
+    // not a regular file, such as a pipe
+    vector<char> buffer(CHUNK);
+    size_t filled = 0;
+    for (;;) {
+        ssize_t got = read(fd_, buffer.data() + filled, buffer.size() - filled);
+        if (got < 0) {
+            invalid_ = true;
+            return pos;
+        }
+        filled += got;
+        bool last = got == 0;
+        size_t used = tokenize_(buffer.data(), filled, last, tape, pos);
+        if (last || invalid_)
+            return pos;
+        copy(buffer.begin() + used, buffer.begin() + filled, buffer.begin());
+        filled -= used;
+        // a single letter longer than the buffer
+        if (filled == buffer.size())
+            buffer.resize(2 * buffer.size());
+    }
+}
+
+size_t InputFile::tokenize_(const char *data, size_t length, bool last,
+                            Tape &tape, size_t &pos) {
+    size_t a = 0;
+    while (a < length) {
+        unsigned char ch = data[a];
+        letter_id letter = single_char_letters_[ch];
+        if (letter != NOT_A_LETTER) {
+            tape.write(pos++, letter);
+            ++a;
+            continue;
+        }
+        if (is_whitespace(ch)) {
+            ++a;
+            continue;
+        }
+        if (ch != '(') {
+            invalid_ = true;
+            return a;
+        }
+
+        // a bracketed letter ends where its brackets are balanced
+        size_t end = a, depth = 0;
+        do {
+            if (data[end] == '(')
+                ++depth;
+            else if (data[end] == ')')
+                --depth;
+            ++end;
+        } while (depth && end < length && !is_whitespace(data[end]));
+        if (depth) {
+            if (!last && end == length)
+                return a;
+            invalid_ = true;
+            return a;
+        }
+        bracketed_.assign(data + a, end - a);
+        const auto it = bracketed_letters_.find(bracketed_);
+        if (it == bracketed_letters_.end()) {
+            invalid_ = true;
+            return a;
+        }
+        tape.write(pos++, it->second);
+        a = end;
+    }
+    return a;
+}
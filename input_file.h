@@ -0,0 +1,54 @@
+#ifndef __INPUT_FILE_H
+#define __INPUT_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tape.h"
+
+/**
+ * An input word too long for the command line, read from a file (mmapped)
+ * or from stdin. It is tokenized straight onto a tape: letters of a single
+ * character are found in a table indexed by the character, no string is
+ * built for them. Whitespace between letters is ignored.
+ */
+class InputFile {
+  public:
+    // "-" stands for stdin
+    InputFile(const std::string &filename,
+              const std::vector<std::string> &input_alphabet);
+
+    InputFile(const InputFile &) = delete;
+
+    ~InputFile();
+
+    bool is_open() const { return fd_ >= 0; }
+
+    // writes the word at the beginning of the tape, returns its length
+    size_t write(LetterTable &letters, Tape &tape);
+
+    // whether the file turned out not to be a sequence of input letters
+    bool invalid() const { return invalid_; }
+
+  private:
+    /**
+     * Writes the letters of data starting at pos, returns the number of bytes
+     * consumed; a bracketed letter cut by the end of data is left unless last
+     */
+    size_t tokenize_(const char *data, size_t length, bool last, Tape &tape,
+                     size_t &pos);
+
+    int fd_;
+    std::vector<std::string> input_alphabet_;
+    bool invalid_;
+
+    static constexpr letter_id NOT_A_LETTER = UINT32_MAX;
+
+    letter_id single_char_letters_[256];
+    std::unordered_map<std::string, letter_id> bracketed_letters_;
+    std::string bracketed_;
+};
+
+#endif
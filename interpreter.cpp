@@ -0,0 +1,227 @@
+#include "interpreter.h"
+
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+
+static const size_t MAX_HEAD = SIZE_MAX >> 2;
+
+namespace {
+
+class MachineTransitions : public TransitionSource {
+  public:
+    MachineTransitions(const TuringMachine &tm) : tm_(tm) {}
+
+    int num_tapes() const override { return tm_.num_tapes; }
+
+    const transitions_t::mapped_type *
+    find(const transitions_t::key_type &key) override {
+        const auto it = tm_.transitions().find(key);
+        return it == tm_.transitions().end() ? nullptr : &it->second;
+    }
+
+  private:
+    const TuringMachine &tm_;
+};
+
+} // namespace
+
+static function<size_t(LetterTable &, Tape &)>
+write_letters(const vector<string> &input) {
+    return [&input](LetterTable &letters, Tape &tape) {
+        for (size_t a = 0; a < input.size(); ++a)
+            tape.write(a, letters.id(input[a]));
+        return input.size();
+    };
+}
+
+Run::Run(const TuringMachine &tm, const vector<string> &input,
+         TapeKind tape_kind)
+    : Run(tm, write_letters(input), tape_kind) {}
+
+Run::Run(TransitionSource &source, const vector<string> &input,
+         TapeKind tape_kind)
+    : Run(source, write_letters(input), tape_kind) {}
+
+Run::Run(const TuringMachine &tm,
+         const function<size_t(LetterTable &, Tape &)> &write_input,
+         TapeKind tape_kind)
+    : Run(make_unique<MachineTransitions>(tm), write_input, tape_kind) {}
+
+Run::Run(unique_ptr<TransitionSource> source,
+         const function<size_t(LetterTable &, Tape &)> &write_input,
+         TapeKind tape_kind)
+    : Run(*source, write_input, tape_kind) {
+    owned_source_ = move(source);
+}
+
+Run::Run(TransitionSource &source,
+         const function<size_t(LetterTable &, Tape &)> &write_input,
+         TapeKind tape_kind)
+    : source_(source), heads_(source.num_tapes(), 0),
+      extents_(source.num_tapes(), 1), input_end_(SIZE_MAX),
+      state_(INITIAL_STATE),
+      verdict_(Verdict::RUNNING), steps_(0) {
+    for (int a = 0; a < source.num_tapes(); ++a)
+        tapes_.push_back(make_tape(tape_kind));
+    extents_[0] = max<size_t>(write_input(letters_, *tapes_[0]), 1);
+    current_.second.resize(source.num_tapes());
+}
+
+void Run::halt_(bool accept, const string &reason) {
+    verdict_ = accept ? Verdict::ACCEPT : Verdict::REJECT;
+    halt_reason_ = reason;
+}
+
+size_t Run::step_(size_t max_steps) {
+    if (verdict_ != Verdict::RUNNING || heads_[0] == input_end_)
+        return 0;
+
+    current_.first = state_;
+    for (size_t a = 0; a < tapes_.size(); ++a)
+        current_.second[a] = letters_.name(tapes_[a]->read(heads_[a]));
+    const auto *found = source_.find(current_);
+    if (!found) {
+        halt_(false, "No transition from this configuration");
+        return 0;
+    }
+    const auto &trans = *found;
+    for (size_t a = 0; a < tapes_.size(); ++a) {
+        if (get<2>(trans)[a] == HEAD_LEFT && !heads_[a]) {
+            ostringstream oss;
+            oss << "Head " << a + 1
+                << " falls off the tape in the next transition";
+            halt_(false, oss.str());
+            return 0;
+        }
+    }
+
+    // the same transition applies again as long as every moving head
+    // keeps reading the same letter, so it may be done many times at once
+    size_t repeats = 1;
+    if (max_steps > 1 && get<0>(trans) == state_ &&
+        get<1>(trans) == current_.second &&
+        any_of(get<2>(trans).begin(), get<2>(trans).end(),
+               [](char dir) { return dir != HEAD_STAY; })) {
+        repeats = max_steps;
+        for (size_t a = 0; a < tapes_.size(); ++a) {
+            char dir = get<2>(trans)[a];
+            if (dir == HEAD_STAY)
+                continue;
+            repeats = min(repeats, tapes_[a]->run_length(heads_[a], dir));
+            // stopping before the undetermined input
+            if (!a && dir == HEAD_RIGHT)
+                repeats = min(repeats, input_end_ - heads_[0]);
+            // stop on the first cell, falling off is handled by the next step
+            if (dir == HEAD_LEFT)
+                repeats = min(repeats, heads_[a]);
+            // sweeping the blanks forever, without overflowing the head
+            else if (heads_[a] < MAX_HEAD)
+                repeats = min(repeats, MAX_HEAD - heads_[a]);
+        }
+    }
+
+    steps_ += repeats;
+    state_ = get<0>(trans);
+    for (size_t a = 0; a < tapes_.size(); ++a) {
+        if (repeats == 1)
+            tapes_[a]->write(heads_[a], letters_.id(get<1>(trans)[a]));
+        char dir = get<2>(trans)[a];
+        if (dir == HEAD_LEFT)
+            heads_[a] -= repeats;
+        else if (dir == HEAD_RIGHT)
+            heads_[a] += repeats;
+        extents_[a] = max(extents_[a], heads_[a] + 1);
+    }
+
+    if (state_ == REJECTING_STATE)
+        halt_(false);
+    else if (state_ == ACCEPTING_STATE)
+        halt_(true);
+    return repeats;
+}
+
+void Run::extend_input(const string &letter) {
+    tapes_[0]->write(input_end_, letters_.id(letter));
+    ++input_end_;
+    extents_[0] = max(extents_[0], input_end_);
+}
+
+bool Run::execute_step() {
+    step_(1);
+    return verdict_ == Verdict::RUNNING;
+}
+
+Verdict Run::run(size_t max_steps) {
+    for (size_t steps = 0; steps < max_steps;) {
+        size_t done = step_(max_steps - steps);
+        if (!done)
+            break;
+        steps += done;
+    }
+    return verdict_;
+}
+
+size_t Run::Checkpoint::bytes() const {
+    size_t res = sizeof(Checkpoint) + state.capacity() + halt_reason.capacity() +
+                 (heads.capacity() + extents.capacity()) * sizeof(size_t);
+    for (const auto &tape : tapes)
+        res += tape->bytes();
+    return res;
+}
+
+Run::Checkpoint Run::checkpoint() const {
+    Checkpoint res{state_, verdict_, steps_, halt_reason_, heads_, extents_,
+                   input_end_, {}};
+    for (const auto &tape : tapes_)
+        res.tapes.push_back(tape->clone());
+    return res;
+}
+
+void Run::restore(const Checkpoint &checkpoint) {
+    state_ = checkpoint.state;
+    verdict_ = checkpoint.verdict;
+    steps_ = checkpoint.steps;
+    halt_reason_ = checkpoint.halt_reason;
+    heads_ = checkpoint.heads;
+    extents_ = checkpoint.extents;
+    input_end_ = checkpoint.input_end;
+    for (size_t a = 0; a < tapes_.size(); ++a)
+        tapes_[a] = checkpoint.tapes[a]->clone();
+}
+
+void Run::print_configuration(ostream &output, size_t window) const {
+    view_.clear();
+    view_ += "State: ";
+    view_ += state_;
+    view_ += "\n";
+    for (size_t a = 0; a < tapes_.size(); ++a) {
+        size_t head = heads_[a];
+        size_t begin = head > window ? head - window : 0;
+        size_t end = extents_[a] - head > window ? head + window + 1
+                                                 : extents_[a];
+
+        size_t line_start = view_.length(), before_head = 0, after_head = 0;
+        view_ += "Tape ";
+        view_ += to_string(a + 1);
+        view_ += ": ";
+        if (begin > 0)
+            view_ += "...";
+        for (size_t b = begin; b < end; ++b) {
+            if (b == head)
+                before_head = view_.length() - line_start;
+            view_ += letters_.name(tapes_[a]->read(b));
+            if (b == head)
+                after_head = view_.length() - line_start;
+        }
+        if (end < extents_[a])
+            view_ += "...";
+        view_ += "\n";
+        view_.append(before_head, ' ');
+        view_.append(after_head - before_head, '^');
+        view_ += "\n";
+    }
+    view_ += "#####################################\n";
+    output.write(view_.data(), view_.length());
+}
@@ -0,0 +1,160 @@
+#ifndef __INTERPRETER_H
+#define __INTERPRETER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tape.h"
+#include "turing_machine.h"
+
+enum class Verdict { RUNNING, ACCEPT, REJECT };
+
+static inline const char *verdict_name(Verdict verdict) {
+    return verdict == Verdict::ACCEPT   ? "ACCEPT"
+           : verdict == Verdict::REJECT ? "REJECT"
+                                        : "RUNNING";
+}
+
+// where a run looks its transitions up
+class TransitionSource {
+  public:
+    virtual ~TransitionSource() = default;
+
+    virtual int num_tapes() const = 0;
+
+    // nullptr if there is no transition from key; the transition may be
+    // valid only until the next call
+    virtual const transitions_t::mapped_type *
+    find(const transitions_t::key_type &key) = 0;
+};
+
+/**
+ * A single execution of a machine on one input word.
+ * Unlike the command line interpreter it never exits the process,
+ * so a parsed machine can be reused for any number of runs.
+ */
+class Run {
+  public:
+    // input is a sequence of letters, as returned by TuringMachine::parse_input
+    Run(const TuringMachine &tm, const std::vector<std::string> &input,
+        TapeKind tape_kind = TapeKind::VECTOR);
+
+    // write_input writes the input word at the beginning of the given tape
+    // and returns its length, for words not worth keeping as strings
+    Run(const TuringMachine &tm,
+        const std::function<size_t(LetterTable &, Tape &)> &write_input,
+        TapeKind tape_kind = TapeKind::VECTOR);
+
+    // runs a machine whose transitions are not all known upfront,
+    // source has to outlive the run
+    Run(TransitionSource &source, const std::vector<std::string> &input,
+        TapeKind tape_kind = TapeKind::VECTOR);
+
+    Run(TransitionSource &source,
+        const std::function<size_t(LetterTable &, Tape &)> &write_input,
+        TapeKind tape_kind = TapeKind::VECTOR);
+
+    // executes a single transition, returns false iff the run has halted
+    bool execute_step();
+
+    /**
+     * Executes at most max_steps transitions, returns the verdict so far.
+     * A transition which does not change the state nor the letters is
+     * executed at once for the whole run of the same letters its heads sweep.
+     */
+    Verdict run(size_t max_steps = SIZE_MAX);
+
+    Verdict verdict() const { return verdict_; }
+
+    size_t steps() const { return steps_; }
+
+    const std::string &state() const { return state_; }
+
+    /**
+     * Leaves the cells of the first tape from input_end on undetermined:
+     * the run stops, as if out of steps, before its head reads the first
+     * of them, until the input is extended or closed
+     */
+    void open_input(size_t input_end) { input_end_ = input_end; }
+
+    // whether the run stopped before reading an undetermined cell
+    bool awaits_input() const {
+        return verdict_ == Verdict::RUNNING && heads_[0] == input_end_;
+    }
+
+    // writes the first undetermined cell, the next one is undetermined
+    void extend_input(const std::string &letter);
+
+    // the undetermined cells are blank, the input ends before them
+    void close_input() { input_end_ = SIZE_MAX; }
+
+    // why the machine halted without reaching the rejecting state,
+    // empty otherwise
+    const std::string &halt_reason() const { return halt_reason_; }
+
+    // everything a run can be brought back to, but its letters,
+    // which are only ever added
+    struct Checkpoint {
+        std::string state;
+        Verdict verdict;
+        size_t steps;
+        std::string halt_reason;
+        std::vector<size_t> heads, extents;
+        size_t input_end;
+        std::vector<std::unique_ptr<Tape>> tapes;
+
+        // about how much memory it takes, mostly the tapes
+        size_t bytes() const;
+    };
+
+    Checkpoint checkpoint() const;
+
+    // the checkpoint has to be of this run, it can be restored again later
+    void restore(const Checkpoint &checkpoint);
+
+    /**
+     * Prints the state and the tapes, each only window cells around its head
+     * (the rest is cut to ...); written to output at once
+     */
+    void print_configuration(std::ostream &output,
+                             size_t window = SIZE_MAX) const;
+
+  private:
+    Run(std::unique_ptr<TransitionSource> source,
+        const std::function<size_t(LetterTable &, Tape &)> &write_input,
+        TapeKind tape_kind);
+
+    // executes a transition, and as long as it stays the same up to
+    // max_steps times; returns the number of steps done
+    size_t step_(size_t max_steps);
+
+    void halt_(bool accept, const std::string &reason = "");
+
+    // set if the run looks up the transitions of a parsed machine
+    std::unique_ptr<TransitionSource> owned_source_;
+    TransitionSource &source_;
+    LetterTable letters_;
+    std::vector<std::unique_ptr<Tape>> tapes_;
+    std::vector<size_t> heads_;
+    // the number of cells visited on each tape
+    std::vector<size_t> extents_;
+    // the cells of the first tape from there on are undetermined, see
+    // open_input
+    size_t input_end_;
+    std::string state_;
+    Verdict verdict_;
+    size_t steps_;
+    std::string halt_reason_;
+
+    // reused between steps, so that looking up a transition does not allocate
+    transitions_t::key_type current_;
+    // reused between prints
+    mutable std::string view_;
+};
+
+#endif
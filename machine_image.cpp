@@ -0,0 +1,138 @@
+#include "machine_image.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <system_error>
+
+using namespace std;
+
+static size_t words_for(size_t bytes) {
+    return (bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+MachineImage::MachineImage(const TuringMachine &tm) {
+    vector<string> names = tm.set_of_states();
+    vector<string> alphabet = tm.working_alphabet();
+    names.insert(names.end(), alphabet.begin(), alphabet.end());
+    sort(names.begin(), names.end());
+    names.erase(unique(names.begin(), names.end()), names.end());
+
+    size_t pool_size = 0;
+    for (const auto &name : names)
+        pool_size += name.length();
+
+    const size_t k = tm.num_tapes;
+    const size_t record_words = 2 + 2 * k + words_for(k);
+    Header header;
+    header.num_tapes = tm.num_tapes;
+    header.num_names = names.size();
+    header.num_transitions = tm.transitions().size();
+    header.names_offset = sizeof(Header);
+    header.records_offset =
+        header.names_offset + (names.size() + 1) * sizeof(uint64_t);
+    header.pool_offset = header.records_offset + tm.transitions().size() *
+                                                     record_words *
+                                                     sizeof(uint32_t);
+    size_ = header.pool_offset + pool_size;
+
+    image_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (image_ == MAP_FAILED)
+        throw system_error(errno, generic_category(),
+                           "Cannot map the machine image of " +
+                               to_string(size_) + " bytes");
+    char *data = (char *)image_;
+    memcpy(data, &header, sizeof(Header));
+
+    header_ = (const Header *)data;
+    names_ = (const uint64_t *)(data + header.names_offset);
+    pool_ = data + header.pool_offset;
+
+    uint64_t *offsets = (uint64_t *)(data + header.names_offset);
+    char *pool = data + header.pool_offset;
+    offsets[0] = 0;
+    for (size_t a = 0; a < names.size(); ++a) {
+        memcpy(pool + offsets[a], names[a].data(), names[a].length());
+        offsets[a + 1] = offsets[a] + names[a].length();
+    }
+
+    // the map is sorted by the names, and so by their indices
+    uint32_t *record = (uint32_t *)(data + header.records_offset);
+    for (const auto &[key, target] : tm.transitions()) {
+        record[0] = name_index_(key.first);
+        for (size_t a = 0; a < k; ++a)
+            record[1 + a] = name_index_(key.second[a]);
+        record[1 + k] = name_index_(get<0>(target));
+        for (size_t a = 0; a < k; ++a)
+            record[2 + k + a] = name_index_(get<1>(target)[a]);
+        char *moves = (char *)(record + 2 + 2 * k);
+        memset(moves, 0, words_for(k) * sizeof(uint32_t));
+        memcpy(moves, get<2>(target).data(), k);
+        record += record_words;
+    }
+
+    mprotect(image_, size_, PROT_READ);
+    key_.resize(1 + k);
+    get<1>(found_).resize(k);
+}
+
+MachineImage::~MachineImage() { munmap(image_, size_); }
+
+string_view MachineImage::name_(uint32_t index) const {
+    return string_view(pool_ + names_[index], names_[index + 1] - names_[index]);
+}
+
+uint32_t MachineImage::name_index_(const string &name) const {
+    uint32_t lo = 0, hi = header_->num_names;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (name_(mid) < name)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < header_->num_names && name_(lo) == name ? lo
+                                                        : header_->num_names;
+}
+
+size_t MachineImage::record_words_() const {
+    return 2 + 2 * header_->num_tapes + words_for(header_->num_tapes);
+}
+
+const uint32_t *MachineImage::record_(size_t index) const {
+    return (const uint32_t *)((const char *)image_ + header_->records_offset) +
+           index * record_words_();
+}
+
+const transitions_t::mapped_type *
+MachineImage::find(const transitions_t::key_type &key) {
+    const size_t k = header_->num_tapes;
+    key_[0] = name_index_(key.first);
+    for (size_t a = 0; a < k; ++a)
+        key_[1 + a] = name_index_(key.second[a]);
+    for (uint32_t index : key_)
+        if (index == header_->num_names)
+            return nullptr;
+
+    size_t lo = 0, hi = header_->num_transitions;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lexicographical_compare(record_(mid), record_(mid) + 1 + k,
+                                    key_.begin(), key_.end()))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == header_->num_transitions ||
+        !equal(key_.begin(), key_.end(), record_(lo)))
+        return nullptr;
+
+    const uint32_t *record = record_(lo);
+    get<0>(found_).assign(name_(record[1 + k]));
+    for (size_t a = 0; a < k; ++a)
+        get<1>(found_)[a].assign(name_(record[2 + k + a]));
+    get<2>(found_).assign((const char *)(record + 2 + 2 * k), k);
+    return &found_;
+}
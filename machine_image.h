@@ -0,0 +1,67 @@
+#ifndef __MACHINE_IMAGE_H
+#define __MACHINE_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "interpreter.h"
+#include "turing_machine.h"
+
+/**
+ * A machine compiled into a single read-only mapping: the sorted names of its
+ * states and letters, and fixed size transition records referring to them by
+ * index, sorted as the transitions themselves. There are no pointers in it,
+ * so processes forked after compiling share it instead of each parsing
+ * the machine or copying its pages.
+ */
+class MachineImage : public TransitionSource {
+  public:
+    MachineImage(const TuringMachine &tm);
+
+    MachineImage(const MachineImage &) = delete;
+
+    ~MachineImage();
+
+    int num_tapes() const override { return header_->num_tapes; }
+
+    // the transition is valid until the next call
+    const transitions_t::mapped_type *
+    find(const transitions_t::key_type &key) override;
+
+  private:
+    struct Header {
+        uint32_t num_tapes;
+        uint32_t num_names;
+        uint64_t num_transitions;
+        // in bytes, from the beginning of the image
+        uint64_t names_offset;
+        uint64_t records_offset;
+        uint64_t pool_offset;
+    };
+
+    // index of the name, num_names if there is no such name
+    uint32_t name_index_(const std::string &name) const;
+
+    std::string_view name_(uint32_t index) const;
+
+    // a record is: state, letters read, target state, letters written (all
+    // name indices), then the moves padded to whole words
+    size_t record_words_() const;
+
+    const uint32_t *record_(size_t index) const;
+
+    void *image_;
+    size_t size_;
+    const Header *header_;
+    // num_names + 1 offsets of the names in the pool
+    const uint64_t *names_;
+    const char *pool_;
+
+    std::vector<uint32_t> key_;
+    transitions_t::mapped_type found_;
+};
+
+#endif
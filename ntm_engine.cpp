@@ -0,0 +1,379 @@
+#include "ntm_engine.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+
+typedef uint32_t Id;
+
+const Id BLANK_ID = 0;
+
+// smaller levels are not worth starting the threads for
+const size_t MIN_PARALLEL_LEVEL = 64;
+
+const size_t NUM_SHARDS = 64;
+
+struct Configuration {
+    Id state;
+    vector<size_t> heads;
+    // trailing blanks are trimmed,
+    // so that equal configurations are stored equally
+    vector<vector<Id>> tapes;
+    uint64_t hash;
+};
+
+struct Choice {
+    Id state;
+    vector<Id> letters;
+    string directions;
+};
+
+struct hash_ids {
+    size_t operator()(const vector<Id> &ids) const {
+        uint64_t res = 14695981039346656037ULL;
+        for (Id id : ids)
+            res = (res ^ id) * 1099511628211ULL;
+        return res;
+    }
+};
+
+class Interner {
+  public:
+    Id get(const string &name) {
+        auto it = ids_.find(name);
+        if (it != ids_.end())
+            return it->second;
+        ids_[name] = names_.size();
+        names_.push_back(name);
+        return names_.size() - 1;
+    }
+
+  private:
+    unordered_map<string, Id> ids_;
+    vector<string> names_;
+};
+
+struct hash_configuration {
+    size_t operator()(const Configuration &configuration) const {
+        return configuration.hash;
+    }
+};
+
+struct equal_configuration {
+    bool operator()(const Configuration &a, const Configuration &b) const {
+        return a.hash == b.hash && a.state == b.state && a.heads == b.heads &&
+               a.tapes == b.tapes;
+    }
+};
+
+// the configurations seen so far, up to a limit on their number;
+// safe to use from many threads
+class SeenSet {
+  public:
+    SeenSet(size_t limit) : limit_(limit), full_(false) {}
+
+    /**
+     * Keeps the configuration if it is new and the limit allows it, the
+     * result staying valid as long as the set; nullptr otherwise
+     */
+    const Configuration *insert(Configuration &&configuration) {
+        Shard &shard = shards_[configuration.hash % NUM_SHARDS];
+        lock_guard<mutex> lock(shard.lock);
+        if (shard.configurations.count(configuration))
+            return nullptr;
+        if (size_.fetch_add(1) >= limit_) {
+            --size_;
+            full_ = true;
+            return nullptr;
+        }
+        return &*shard.configurations.insert(move(configuration)).first;
+    }
+
+    size_t size() const { return size_; }
+
+    // whether a configuration was dropped because of the limit
+    bool full() const { return full_; }
+
+  private:
+    struct Shard {
+        mutex lock;
+        unordered_set<Configuration, hash_configuration, equal_configuration>
+            configurations;
+    };
+
+    const size_t limit_;
+    Shard shards_[NUM_SHARDS];
+    atomic<size_t> size_{0};
+    atomic<bool> full_;
+};
+
+// runs a job on all its threads at once, keeping them between the jobs
+class WorkerPool {
+  public:
+    WorkerPool(unsigned threads) : running_(0), generation_(0), stopping_(false) {
+        for (unsigned a = 0; a < threads; ++a)
+            threads_.emplace_back([this, a]() { work_(a); });
+    }
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(lock_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto &worker : threads_)
+            worker.join();
+    }
+
+    // calls job with the number of each thread, returns once all are done
+    void run(const function<void(unsigned)> &job) {
+        unique_lock<mutex> lock(lock_);
+        job_ = &job;
+        running_ = threads_.size();
+        ++generation_;
+        wake_.notify_all();
+        done_.wait(lock, [this]() { return !running_; });
+    }
+
+  private:
+    void work_(unsigned a) {
+        size_t done = 0;
+        unique_lock<mutex> lock(lock_);
+        for (;;) {
+            wake_.wait(lock,
+                       [&]() { return stopping_ || generation_ != done; });
+            if (stopping_)
+                return;
+            done = generation_;
+            const auto &job = *job_;
+            lock.unlock();
+            job(a);
+            lock.lock();
+            if (!--running_)
+                done_.notify_one();
+        }
+    }
+
+    mutex lock_;
+    condition_variable wake_, done_;
+    const function<void(unsigned)> *job_;
+    size_t running_, generation_;
+    bool stopping_;
+    vector<thread> threads_;
+};
+
+class WorkQueue {
+  public:
+    void push(const Configuration *configuration) {
+        lock_guard<mutex> lock(lock_);
+        items_.push_back(configuration);
+    }
+
+    // the owner takes from the back, thieves from the front
+    bool pop(const Configuration *&res, bool steal) {
+        lock_guard<mutex> lock(lock_);
+        if (items_.empty())
+            return false;
+        if (steal) {
+            res = items_.front();
+            items_.pop_front();
+        } else {
+            res = items_.back();
+            items_.pop_back();
+        }
+        return true;
+    }
+
+  private:
+    mutex lock_;
+    deque<const Configuration *> items_;
+};
+
+} // namespace
+
+class NtmExplorer::Impl {
+  public:
+    Impl(const NondeterministicTuringMachine &tm, const NtmLimits &limits)
+        : limits_(limits), accepted_(false) {
+        letters_.get(BLANK);
+        for (const auto &letter : tm.input_alphabet)
+            letters_.get(letter);
+        initial_ = states_.get(INITIAL_STATE);
+        accepting_ = states_.get(ACCEPTING_STATE);
+        rejecting_ = states_.get(REJECTING_STATE);
+        for (const auto &[key, target] : tm.transitions) {
+            vector<Id> ids{states_.get(key.first)};
+            for (const auto &letter : key.second)
+                ids.push_back(letters_.get(letter));
+            Choice choice{states_.get(get<0>(target)), {}, get<2>(target)};
+            for (const auto &letter : get<1>(target))
+                choice.letters.push_back(letters_.get(letter));
+            choices_[ids].push_back(choice);
+        }
+        num_tapes_ = tm.num_tapes;
+    }
+
+    // the configurations of one word are of no use for the next one
+    NtmResult explore(const vector<string> &input, bool verbose) {
+        seen_ = make_unique<SeenSet>(max<size_t>(limits_.max_configurations, 1));
+        accepted_ = false;
+        NtmResult res = explore_(input, verbose);
+        seen_.reset();
+        return res;
+    }
+
+  private:
+    NtmResult explore_(const vector<string> &input, bool verbose) {
+        Configuration initial{initial_, vector<size_t>(num_tapes_, 0),
+                              vector<vector<Id>>(num_tapes_), 0};
+        for (const auto &letter : input)
+            initial.tapes[0].push_back(letters_.get(letter));
+        normalize_(initial);
+
+        // the configurations of a level are kept in seen_
+        vector<const Configuration *> frontier{seen_->insert(move(initial))};
+        for (size_t depth = 0;; ++depth) {
+            if (verbose)
+                cerr << "Step " << depth << ": " << frontier.size()
+                     << " configurations\n";
+            if (frontier.empty())
+                return NtmResult{Verdict::REJECT, depth, seen_->size()};
+            if (depth >= limits_.max_steps)
+                return NtmResult{Verdict::RUNNING, depth, seen_->size()};
+
+            frontier = expand_(frontier);
+            if (accepted_)
+                return NtmResult{Verdict::ACCEPT, depth + 1, seen_->size()};
+            // a level cut short may have lost the only accepting branch
+            if (seen_->full())
+                return NtmResult{Verdict::RUNNING, depth + 1, seen_->size()};
+        }
+    }
+
+    vector<const Configuration *>
+    expand_(const vector<const Configuration *> &frontier) {
+        unsigned threads = limits_.threads;
+        if (threads <= 1 || frontier.size() < MIN_PARALLEL_LEVEL) {
+            vector<const Configuration *> next;
+            for (const auto *configuration : frontier) {
+                if (accepted_ || seen_->full())
+                    break;
+                successors_(*configuration, next);
+            }
+            return next;
+        }
+
+        vector<WorkQueue> queues(threads);
+        for (size_t a = 0; a < frontier.size(); ++a)
+            queues[a % threads].push(frontier[a]);
+
+        vector<vector<const Configuration *>> next(threads);
+        if (!workers_)
+            workers_ = make_unique<WorkerPool>(threads);
+        workers_->run([&](unsigned a) {
+            const Configuration *configuration;
+            for (;;) {
+                if (accepted_ || seen_->full())
+                    return;
+                bool found = queues[a].pop(configuration, false);
+                for (unsigned b = 1; !found && b < threads; ++b)
+                    found = queues[(a + b) % threads].pop(configuration, true);
+                // no work is added during a level, so we are done
+                if (!found)
+                    return;
+                successors_(*configuration, next[a]);
+            }
+        });
+
+        vector<const Configuration *> res;
+        for (const auto &part : next)
+            res.insert(res.end(), part.begin(), part.end());
+        return res;
+    }
+
+    void successors_(const Configuration &configuration,
+                     vector<const Configuration *> &res) {
+        vector<Id> key{configuration.state};
+        for (int a = 0; a < num_tapes_; ++a)
+            key.push_back(read_(configuration, a));
+        auto it = choices_.find(key);
+        if (it == choices_.end())
+            return;
+
+        for (const Choice &choice : it->second) {
+            bool falls_off = false;
+            for (int a = 0; a < num_tapes_; ++a)
+                falls_off |= choice.directions[a] == HEAD_LEFT &&
+                             configuration.heads[a] == 0;
+            if (falls_off || choice.state == rejecting_)
+                continue;
+            if (choice.state == accepting_) {
+                accepted_ = true;
+                return;
+            }
+
+            Configuration next = configuration;
+            next.state = choice.state;
+            for (int a = 0; a < num_tapes_; ++a) {
+                auto &tape = next.tapes[a];
+                auto &head = next.heads[a];
+                if (head >= tape.size())
+                    tape.resize(head + 1, BLANK_ID);
+                tape[head] = choice.letters[a];
+                char dir = choice.directions[a];
+                head += dir == HEAD_LEFT ? -1 : dir == HEAD_RIGHT ? 1 : 0;
+            }
+            normalize_(next);
+            if (const Configuration *kept = seen_->insert(move(next)))
+                res.push_back(kept);
+        }
+    }
+
+    Id read_(const Configuration &configuration, int tape) const {
+        const auto &cells = configuration.tapes[tape];
+        size_t head = configuration.heads[tape];
+        return head < cells.size() ? cells[head] : BLANK_ID;
+    }
+
+    static void normalize_(Configuration &configuration) {
+        uint64_t hash = hash_ids()(vector<Id>{configuration.state});
+        for (size_t a = 0; a < configuration.tapes.size(); ++a) {
+            auto &tape = configuration.tapes[a];
+            while (!tape.empty() && tape.back() == BLANK_ID)
+                tape.pop_back();
+            hash = (hash ^ configuration.heads[a]) * 1099511628211ULL;
+            hash = (hash ^ hash_ids()(tape)) * 1099511628211ULL;
+        }
+        configuration.hash = hash;
+    }
+
+    const NtmLimits limits_;
+    int num_tapes_;
+    Interner states_, letters_;
+    Id initial_, accepting_, rejecting_;
+    unordered_map<vector<Id>, vector<Choice>, hash_ids> choices_;
+    unique_ptr<SeenSet> seen_;
+    atomic<bool> accepted_;
+    // started on the first level large enough
+    unique_ptr<WorkerPool> workers_;
+};
+
+NtmExplorer::NtmExplorer(const NondeterministicTuringMachine &tm,
+                         const NtmLimits &limits)
+    : impl_(make_unique<Impl>(tm, limits)) {}
+
+NtmExplorer::~NtmExplorer() = default;
+
+NtmResult NtmExplorer::explore(const vector<string> &input, bool verbose) {
+    return impl_->explore(input, verbose);
+}
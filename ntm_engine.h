@@ -0,0 +1,54 @@
+#ifndef __NTM_ENGINE_H
+#define __NTM_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+#include "turing_machine.h"
+
+struct NtmLimits {
+    // depth of the configuration tree, i.e. the number of steps of any branch
+    size_t max_steps = SIZE_MAX;
+    // number of distinct configurations kept in memory, checked on each one
+    size_t max_configurations = 10000000;
+    unsigned threads = 1;
+};
+
+struct NtmResult {
+    // ACCEPT if some branch accepts, REJECT if every branch halts
+    // without accepting, RUNNING if a limit was hit before either happened
+    Verdict verdict;
+    size_t steps;
+    size_t configurations;
+};
+
+/**
+ * Explores the tree of configurations of a nondeterministic machine
+ * breadth-first. Each level of the tree is spread across the threads, which
+ * steal work from each other; configurations already seen are not explored
+ * again. Stops as soon as any branch accepts, or once max_configurations
+ * are kept.
+ * The transitions are indexed once, and the threads started once, for all
+ * the words explored.
+ */
+class NtmExplorer {
+  public:
+    NtmExplorer(const NondeterministicTuringMachine &tm,
+                const NtmLimits &limits);
+
+    NtmExplorer(const NtmExplorer &) = delete;
+
+    ~NtmExplorer();
+
+    NtmResult explore(const std::vector<std::string> &input, bool verbose);
+
+  private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+Scheduler::Scheduler(size_t time_slice) : time_slice_(time_slice) {
+    assert(time_slice > 0);
+}
+
+Scheduler::TaskId Scheduler::add(unique_ptr<Run> run, unsigned priority,
+                                 size_t max_steps) {
+    assert(priority > 0);
+    tasks_.push_back(Task{move(run), priority, max_steps, false});
+    ready_.push_back(tasks_.size() - 1);
+    return tasks_.size() - 1;
+}
+
+void Scheduler::cancel(TaskId id) { tasks_[id].cancelled = true; }
+
+void Scheduler::cancel_all() {
+    for (TaskId id : ready_)
+        tasks_[id].cancelled = true;
+}
+
+void Scheduler::run(const DoneCallback &on_done) {
+    while (!ready_.empty()) {
+        TaskId id = ready_.front();
+        ready_.pop_front();
+        Task &task = tasks_[id];
+
+        TaskEnd end = TaskEnd::CANCELLED;
+        if (!task.cancelled) {
+            Run &run = *task.run;
+            size_t slice = task.priority * time_slice_;
+            if (slice / task.priority != time_slice_)
+                slice = SIZE_MAX;
+            slice = min(slice, task.max_steps - run.steps());
+            if (run.run(slice) != Verdict::RUNNING)
+                end = TaskEnd::HALTED;
+            else if (run.steps() >= task.max_steps)
+                end = TaskEnd::OUT_OF_STEPS;
+            else {
+                ready_.push_back(id);
+                continue;
+            }
+        }
+
+        // on_done may add or cancel tasks, so the task is not kept by reference
+        unique_ptr<Run> run = move(task.run);
+        on_done(id, *run, end);
+    }
+}
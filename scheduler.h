@@ -0,0 +1,62 @@
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "interpreter.h"
+
+enum class TaskEnd {
+    HALTED,
+    // the task executed all the steps it was allowed to
+    OUT_OF_STEPS,
+    CANCELLED,
+};
+
+/**
+ * Interleaves many runs on the calling thread. A run is resumed for a time
+ * slice of steps, then the next one gets its turn, round-robin; a run of
+ * priority p gets p time slices per turn.
+ */
+class Scheduler {
+  public:
+    typedef size_t TaskId;
+
+    typedef std::function<void(TaskId, const Run &, TaskEnd)> DoneCallback;
+
+    Scheduler(size_t time_slice);
+
+    // max_steps is the quota of the run, after which it is given up
+    TaskId add(std::unique_ptr<Run> run, unsigned priority = 1,
+               size_t max_steps = SIZE_MAX);
+
+    // may be called from on_done, e.g. once a run accepted
+    void cancel(TaskId id);
+
+    void cancel_all();
+
+    /**
+     * Executes the tasks until none is left; on_done is called once for each,
+     * when it ends, after which its run is freed
+     */
+    void run(const DoneCallback &on_done);
+
+  private:
+    struct Task {
+        std::unique_ptr<Run> run;
+        unsigned priority;
+        size_t max_steps;
+        bool cancelled;
+    };
+
+    size_t time_slice_;
+    std::vector<Task> tasks_;
+    // the tasks waiting for their turn
+    std::deque<TaskId> ready_;
+};
+
+#endif
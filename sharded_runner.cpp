@@ -0,0 +1,243 @@
+#include "sharded_runner.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// lines sent to a worker at once
+const size_t SHARD = 64;
+
+struct Worker {
+    pid_t pid = 0;
+    // write end of the lines, read end of the answers
+    int lines, answers;
+    // an answer read partially
+    string buffer;
+    // lines sent and not answered yet, in order, with their numbers
+    deque<pair<size_t, string>> pending;
+};
+
+bool write_all(int fd, const string &data) {
+    for (size_t done = 0; done < data.length();) {
+        ssize_t res = write(fd, data.data() + done, data.length() - done);
+        if (res < 0 && errno == EINTR)
+            continue;
+        if (res < 0)
+            return false;
+        done += res;
+    }
+    return true;
+}
+
+[[noreturn]] void work(int lines, int answers,
+                       const function<string(const string &)> &answer,
+                       const ShardedRunnerLimits &limits) {
+    if (limits.worker_memory) {
+        rlimit limit{limits.worker_memory, limits.worker_memory};
+        setrlimit(RLIMIT_AS, &limit);
+    }
+    FILE *input = fdopen(lines, "r");
+    char *line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, input)) >= 0) {
+        if (length && line[length - 1] == '\n')
+            --length;
+        string res = answer(string(line, length));
+        res += '\n';
+        if (!write_all(answers, res))
+            break;
+    }
+    _exit(0);
+}
+
+class Coordinator {
+  public:
+    Coordinator(ostream &output,
+                const function<string(const string &)> &answer,
+                const ShardedRunnerLimits &limits)
+        : output_(output), answer_(answer), limits_(limits),
+          workers_(limits.workers) {
+        // a dead worker is found out by reading its answers
+        signal(SIGPIPE, SIG_IGN);
+        for (auto &worker : workers_)
+            spawn_(worker);
+    }
+
+    void run(istream &input) {
+        size_t num_lines = 0;
+        bool input_done = false;
+        for (;;) {
+            while (!input_done && queue_.size() < workers_.size() * SHARD) {
+                string line;
+                if (!getline(input, line)) {
+                    input_done = true;
+                    break;
+                }
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                queue_.emplace_back(num_lines++, move(line));
+            }
+
+            bool busy = false;
+            for (auto &worker : workers_) {
+                dispatch_(worker);
+                busy |= !worker.pending.empty();
+            }
+            if (!busy && queue_.empty())
+                break;
+
+            collect_();
+            flush_();
+        }
+
+        for (auto &worker : workers_) {
+            close(worker.lines);
+            close(worker.answers);
+            waitpid(worker.pid, nullptr, 0);
+        }
+    }
+
+  private:
+    void spawn_(Worker &worker) {
+        int lines[2], answers[2];
+        if (pipe(lines) || pipe(answers)) {
+            perror("pipe");
+            exit(1);
+        }
+        // or the worker would write it again
+        output_.flush();
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(1);
+        }
+        if (!pid) {
+            close(lines[1]);
+            close(answers[0]);
+            // the other workers see the end of their lines only once
+            // no one else holds the pipes open
+            for (auto &other : workers_) {
+                if (&other != &worker && other.pid > 0) {
+                    close(other.lines);
+                    close(other.answers);
+                }
+            }
+            work(lines[0], answers[1], answer_, limits_);
+        }
+        close(lines[0]);
+        close(answers[1]);
+        worker.pid = pid;
+        worker.lines = lines[1];
+        worker.answers = answers[0];
+        worker.buffer.clear();
+        worker.pending.clear();
+    }
+
+    void dispatch_(Worker &worker) {
+        string shard;
+        while (worker.pending.size() < SHARD && !queue_.empty()) {
+            shard += queue_.front().second;
+            shard += '\n';
+            worker.pending.push_back(move(queue_.front()));
+            queue_.pop_front();
+        }
+        // if the worker is dead, it is found out while collecting
+        write_all(worker.lines, shard);
+    }
+
+    void collect_() {
+        vector<pollfd> fds;
+        vector<Worker *> polled;
+        for (auto &worker : workers_) {
+            if (!worker.pending.empty()) {
+                fds.push_back(pollfd{worker.answers, POLLIN, 0});
+                polled.push_back(&worker);
+            }
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0)
+            return;
+
+        char data[1 << 16];
+        for (size_t a = 0; a < fds.size(); ++a) {
+            if (!fds[a].revents)
+                continue;
+            Worker &worker = *polled[a];
+            ssize_t got = read(worker.answers, data, sizeof(data));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0) {
+                replace_(worker);
+                continue;
+            }
+            worker.buffer.append(data, got);
+            size_t begin = 0, end;
+            while ((end = worker.buffer.find('\n', begin)) != string::npos) {
+                answers_[worker.pending.front().first] =
+                    worker.buffer.substr(begin, end - begin);
+                worker.pending.pop_front();
+                begin = end + 1;
+            }
+            worker.buffer.erase(0, begin);
+        }
+    }
+
+    // every answer of a dead worker was read, so it died on its first line
+    void replace_(Worker &worker) {
+        close(worker.lines);
+        close(worker.answers);
+        int status;
+        waitpid(worker.pid, &status, 0);
+        string reason = WIFSIGNALED(status)
+                            ? "killed by signal " + to_string(WTERMSIG(status))
+                            : "exited with " + to_string(WEXITSTATUS(status));
+        answers_[worker.pending.front().first] =
+            "ERROR: The worker died, " + reason;
+        worker.pending.pop_front();
+        for (auto it = worker.pending.rbegin(); it != worker.pending.rend();
+             ++it)
+            queue_.push_front(move(*it));
+        worker.pid = 0;
+        spawn_(worker);
+    }
+
+    void flush_() {
+        bool any = false;
+        for (auto it = answers_.begin();
+             it != answers_.end() && it->first == next_answer_;
+             it = answers_.erase(it), ++next_answer_) {
+            output_ << it->second << "\n";
+            any = true;
+        }
+        if (any)
+            output_.flush();
+    }
+
+    ostream &output_;
+    const function<string(const string &)> &answer_;
+    const ShardedRunnerLimits &limits_;
+    vector<Worker> workers_;
+    // lines read and not sent yet, with their numbers
+    deque<pair<size_t, string>> queue_;
+    map<size_t, string> answers_;
+    size_t next_answer_ = 0;
+};
+
+} // namespace
+
+void run_sharded(istream &input, ostream &output,
+                 const function<string(const string &)> &answer,
+                 const ShardedRunnerLimits &limits) {
+    Coordinator(output, answer, limits).run(input);
+}
@@ -0,0 +1,26 @@
+#ifndef __SHARDED_RUNNER_H
+#define __SHARDED_RUNNER_H
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+
+struct ShardedRunnerLimits {
+    unsigned workers = 1;
+    // bytes of address space of each worker, unlimited if 0
+    size_t worker_memory = 0;
+};
+
+/**
+ * Answers the lines of input on output, in order. The lines are sent in
+ * shards over pipes to worker processes forked from this one, so answer runs
+ * in the workers and sees whatever was built before calling this.
+ * A worker which dies (e.g. out of its memory) is replaced; the line it was
+ * answering gets an error, the rest of its shard goes to the other workers.
+ */
+void run_sharded(std::istream &input, std::ostream &output,
+                 const std::function<std::string(const std::string &)> &answer,
+                 const ShardedRunnerLimits &limits);
+
+#endif
@@ -1,18 +1,25 @@
-#include <sstream>
+#include <charconv>
 
 #include "symbol_set.h"
 
+static void append_hex(std::string &res, int number) {
+    char buffer[2 * sizeof(number)];
+    const auto end = std::to_chars(buffer, buffer + sizeof(buffer), number, 16);
+    res.append(buffer, end.ptr);
+}
+
 SymbolSet::SymbolSet(const std::vector<std::string> &symbols)
     : symbols_(symbols.begin(), symbols.end()), counter_(0) {}
 
+void SymbolSet::insert(const std::string &symbol) { symbols_.insert(symbol); }
+
 std::string SymbolSet::generate() {
-    std::stringstream ss;
     std::string res;
 
     do {
-        ss << "(" << std::hex << ++counter_ << ")";
-        ss >> res;
-        ss.clear();
+        res = "(";
+        append_hex(res, ++counter_);
+        res += ")";
     } while (symbols_.find(res) != symbols_.end());
 
     symbols_.insert(res);
@@ -20,20 +27,17 @@ std::string SymbolSet::generate() {
 }
 
 std::string SymbolSet::generate(const std::string &inspiration) {
-    int local_counter = 0;
-
     std::string res = "(" + inspiration + ")";
     if (symbols_.find(res) == symbols_.end()) {
         symbols_.insert(res);
         return res;
     } else {
-        std::stringstream ss;
+        int &local_counter = local_counters_[inspiration];
 
         do {
-
-            ss << "(" << inspiration << std::hex << local_counter++ << ")";
-            ss >> res;
-            ss.clear();
+            res.resize(inspiration.size() + 1);
+            append_hex(res, local_counter++);
+            res += ")";
         } while (symbols_.find(res) != symbols_.end());
         symbols_.insert(res);
         return res;
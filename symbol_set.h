@@ -1,4 +1,8 @@
+#ifndef __SYMBOL_SET_H
+#define __SYMBOL_SET_H
+
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "turing_machine.h"
@@ -7,14 +11,23 @@ class SymbolSet {
   private:
     std::unordered_set<std::string> symbols_;
 
-    int counter_;
+    int counter_ = 0;
+
+    // the next suffix to try for each inspiration;
+    // all the smaller ones are already taken
+    std::unordered_map<std::string, int> local_counters_;
 
   public:
     SymbolSet(const std::vector<std::string> &symols);
 
     SymbolSet() = default;
 
+    // marks an already used symbol, so that it is never generated
+    void insert(const std::string &symbol);
+
     std::string generate();
 
     std::string generate(const std::string &inspiration);
 };
+
+#endif
@@ -0,0 +1,339 @@
+#include "tape.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <filesystem>
+#include <sstream>
+#include <sys/mman.h>
+#include <system_error>
+#include <unistd.h>
+
+#include "turing_machine.h"
+
+// the file grows at least by this many bytes at once
+#define MAPPED_TAPE_GROWTH (64 << 20)
+
+LetterTable::LetterTable() { id(BLANK); }
+
+letter_id LetterTable::id(const std::string &letter) {
+    const auto it = ids_.find(letter);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    ids_[letter] = names_.size();
+    names_.push_back(letter);
+    return names_.size() - 1;
+}
+
+std::unique_ptr<Tape> make_tape(TapeKind kind) {
+    switch (kind) {
+    case TapeKind::RLE:
+        return std::make_unique<RleTape>();
+    case TapeKind::MAPPED:
+        return std::make_unique<MappedTape>();
+    case TapeKind::SHARED:
+        return std::make_unique<SharedTape>();
+    default:
+        return std::make_unique<VectorTape>();
+    }
+}
+
+letter_id VectorTape::read(size_t pos) const {
+    return pos < cells_.size() ? cells_[pos] : LetterTable::BLANK_ID;
+}
+
+void VectorTape::write(size_t pos, letter_id letter) {
+    if (pos >= cells_.size()) {
+        if (letter == LetterTable::BLANK_ID) {
+            return;
+        }
+        cells_.resize(pos + 1, LetterTable::BLANK_ID);
+    }
+    cells_[pos] = letter;
+}
+
+size_t VectorTape::run_length(size_t pos, char direction) const {
+    const letter_id letter = read(pos);
+    size_t res = 1;
+    if (direction == HEAD_LEFT) {
+        while (res <= pos && read(pos - res) == letter) {
+            ++res;
+        }
+    } else {
+        while (pos + res < cells_.size() && cells_[pos + res] == letter) {
+            ++res;
+        }
+        if (pos + res >= cells_.size() && letter == LetterTable::BLANK_ID) {
+            return SIZE_MAX;
+        }
+    }
+    return res;
+}
+
+std::unique_ptr<Tape> VectorTape::clone() const {
+    return std::make_unique<VectorTape>(*this);
+}
+
+RleTape::RleTape() : end_(0), last_(segments_.end()) {}
+
+std::unique_ptr<Tape> RleTape::clone() const {
+    auto res = std::make_unique<RleTape>();
+    res->segments_ = segments_;
+    res->end_ = end_;
+    return res;
+}
+
+size_t RleTape::bytes() const {
+    // a node of the tree, with its pointers and the allocator overhead
+    return segments_.size() * (sizeof(Segments::value_type) + 48);
+}
+
+RleTape::Segments::iterator RleTape::find_(size_t pos) const {
+    assert(pos < end_);
+    if (last_ != segments_.end() && last_->first <= pos &&
+        pos < last_->first + last_->second.length) {
+        return last_;
+    }
+    last_ = std::prev(segments_.upper_bound(pos));
+    return last_;
+}
+
+letter_id RleTape::read(size_t pos) const {
+    return pos < end_ ? find_(pos)->second.letter : LetterTable::BLANK_ID;
+}
+
+void RleTape::merge_(Segments::iterator it) {
+    if (it != segments_.begin()) {
+        const auto prev = std::prev(it);
+        if (prev->second.letter == it->second.letter) {
+            prev->second.length += it->second.length;
+            segments_.erase(it);
+            it = prev;
+        }
+    }
+    const auto next = std::next(it);
+    if (next != segments_.end() && next->second.letter == it->second.letter) {
+        it->second.length += next->second.length;
+        segments_.erase(next);
+    }
+    last_ = it;
+}
+
+void RleTape::write(size_t pos, letter_id letter) {
+    if (pos >= end_) {
+        if (letter == LetterTable::BLANK_ID) {
+            return;
+        }
+        if (pos > end_) {
+            merge_(segments_
+                       .emplace(end_, Segment{LetterTable::BLANK_ID, pos - end_})
+                       .first);
+        }
+        end_ = pos + 1;
+        merge_(segments_.emplace(pos, Segment{letter, 1}).first);
+        return;
+    }
+
+    auto it = find_(pos);
+    const Segment old = it->second;
+    if (old.letter == letter) {
+        return;
+    }
+
+    // split into the part before pos, pos itself, and the part after it
+    const size_t start = it->first;
+    if (pos + 1 < start + old.length) {
+        segments_.emplace(pos + 1,
+                          Segment{old.letter, start + old.length - pos - 1});
+    }
+    if (start < pos) {
+        it->second.length = pos - start;
+        it = segments_.emplace(pos, Segment{letter, 1}).first;
+    } else {
+        it->second = Segment{letter, 1};
+    }
+    merge_(it);
+}
+
+size_t RleTape::run_length(size_t pos, char direction) const {
+    if (pos >= end_) {
+        if (direction != HEAD_LEFT) {
+            return SIZE_MAX;
+        }
+        size_t res = pos - end_ + 1;
+        if (end_ && read(end_ - 1) == LetterTable::BLANK_ID) {
+            const auto it = find_(end_ - 1);
+            res += it->second.length;
+        }
+        return res;
+    }
+
+    const auto it = find_(pos);
+    if (direction == HEAD_LEFT) {
+        return pos - it->first + 1;
+    }
+    if (std::next(it) == segments_.end() &&
+        it->second.letter == LetterTable::BLANK_ID) {
+        return SIZE_MAX;
+    }
+    return it->first + it->second.length - pos;
+}
+
+MappedTape::MappedTape() : cells_(nullptr), capacity_(0), end_(0) {
+    std::ostringstream name;
+    name << "tm-tape-" << getpid() << "-" << this;
+    filename_ = (std::filesystem::temp_directory_path() / name.str()).string();
+    fd_ = open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                "Cannot create the tape file " + filename_);
+    }
+}
+
+MappedTape::~MappedTape() {
+    if (cells_) {
+        munmap(cells_, capacity_ * sizeof(letter_id));
+    }
+    close(fd_);
+    unlink(filename_.c_str());
+}
+
+void MappedTape::grow_(size_t pos) {
+    const size_t old_bytes = capacity_ * sizeof(letter_id);
+    size_t bytes = std::max<size_t>(2 * old_bytes, MAPPED_TAPE_GROWTH);
+    while (bytes < (pos + 1) * sizeof(letter_id)) {
+        bytes *= 2;
+    }
+
+    // the new part of the file is a hole, no disk space is taken yet
+    if (ftruncate(fd_, bytes)) {
+        throw std::system_error(errno, std::generic_category(),
+                                "Cannot grow the tape file " + filename_);
+    }
+    void *cells =
+        cells_ ? mremap(cells_, old_bytes, bytes, MREMAP_MAYMOVE)
+               : mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (cells == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(),
+                                "Cannot map the tape file " + filename_);
+    }
+    cells_ = (letter_id *)cells;
+    capacity_ = bytes / sizeof(letter_id);
+}
+
+std::unique_ptr<Tape> MappedTape::clone() const {
+    auto res = std::make_unique<MappedTape>();
+    if (!end_) {
+        return res;
+    }
+    res->grow_(end_ - 1);
+    res->end_ = end_;
+
+    // in the kernel, which shares the blocks of both files instead where
+    // the file system can (e.g. btrfs or XFS); through memory otherwise
+    const size_t bytes = end_ * sizeof(letter_id);
+    loff_t offset_in = 0, offset_out = 0;
+    while ((size_t)offset_in < bytes) {
+        const ssize_t copied = copy_file_range(fd_, &offset_in, res->fd_,
+                                               &offset_out,
+                                               bytes - offset_in, 0);
+        if (copied <= 0) {
+            break;
+        }
+    }
+    const size_t done = offset_in / sizeof(letter_id);
+    std::copy(cells_ + done, cells_ + end_, res->cells_ + done);
+    return res;
+}
+
+letter_id MappedTape::read(size_t pos) const {
+    return pos < end_ ? cells_[pos] : LetterTable::BLANK_ID;
+}
+
+void MappedTape::write(size_t pos, letter_id letter) {
+    if (pos >= end_) {
+        if (letter == LetterTable::BLANK_ID) {
+            return;
+        }
+        if (pos >= capacity_) {
+            grow_(pos);
+        }
+        end_ = pos + 1;
+    }
+    cells_[pos] = letter;
+}
+
+size_t MappedTape::run_length(size_t pos, char direction) const {
+    const letter_id letter = read(pos);
+    size_t res = 1;
+    if (direction == HEAD_LEFT) {
+        while (res <= pos && read(pos - res) == letter) {
+            ++res;
+        }
+    } else {
+        while (pos + res < end_ && cells_[pos + res] == letter) {
+            ++res;
+        }
+        if (pos + res >= end_ && letter == LetterTable::BLANK_ID) {
+            return SIZE_MAX;
+        }
+    }
+    return res;
+}
+
+SharedTape::SharedTape() : end_(0) {}
+
+letter_id SharedTape::read(size_t pos) const {
+    return pos < end_ ? (*chunks_[pos / CHUNK_CELLS])[pos % CHUNK_CELLS]
+                      : LetterTable::BLANK_ID;
+}
+
+void SharedTape::write(size_t pos, letter_id letter) {
+    if (pos >= end_) {
+        if (letter == LetterTable::BLANK_ID) {
+            return;
+        }
+        // the new chunks are blank
+        while (chunks_.size() <= pos / CHUNK_CELLS) {
+            chunks_.push_back(std::make_shared<Chunk>());
+        }
+        end_ = pos + 1;
+    }
+    auto &chunk = chunks_[pos / CHUNK_CELLS];
+    if (chunk.use_count() > 1) {
+        if ((*chunk)[pos % CHUNK_CELLS] == letter) {
+            return;
+        }
+        chunk = std::make_shared<Chunk>(*chunk);
+    }
+    (*chunk)[pos % CHUNK_CELLS] = letter;
+}
+
+size_t SharedTape::run_length(size_t pos, char direction) const {
+    const letter_id letter = read(pos);
+    size_t res = 1;
+    if (direction == HEAD_LEFT) {
+        while (res <= pos && read(pos - res) == letter) {
+            ++res;
+        }
+    } else {
+        while (pos + res < end_ && read(pos + res) == letter) {
+            ++res;
+        }
+        if (pos + res >= end_ && letter == LetterTable::BLANK_ID) {
+            return SIZE_MAX;
+        }
+    }
+    return res;
+}
+
+std::unique_ptr<Tape> SharedTape::clone() const {
+    return std::make_unique<SharedTape>(*this);
+}
+
+size_t SharedTape::bytes() const {
+    return chunks_.capacity() * sizeof(chunks_[0]) +
+           chunks_.size() * sizeof(Chunk);
+}
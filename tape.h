@@ -0,0 +1,206 @@
+#ifndef __TAPE_H
+#define __TAPE_H
+
+#include <cstddef>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef uint32_t letter_id;
+
+// letters of a run, numbered in order of appearance; the blank is always 0
+class LetterTable {
+  public:
+    static constexpr letter_id BLANK_ID = 0;
+
+    LetterTable();
+
+    // adds the letter if it is new
+    letter_id id(const std::string &letter);
+
+    const std::string &name(letter_id id) const { return names_[id]; }
+
+  private:
+    std::unordered_map<std::string, letter_id> ids_;
+    std::vector<std::string> names_;
+};
+
+/**
+ * A tape infinite to the right, holding blanks wherever nothing was written
+ */
+class Tape {
+  public:
+    virtual ~Tape() = default;
+
+    virtual letter_id read(size_t pos) const = 0;
+
+    virtual void write(size_t pos, letter_id letter) = 0;
+
+    /**
+     * The number of consecutive cells holding the same letter, starting at pos
+     * and going in the direction (HEAD_LEFT or HEAD_RIGHT); going left it is
+     * at most pos + 1, going right it is SIZE_MAX if only blanks follow
+     */
+    virtual size_t run_length(size_t pos, char direction) const = 0;
+
+    // a hint that about this many cells are going to be written
+    virtual void reserve(size_t) {}
+
+    // a copy of the cells, kept the same way
+    virtual std::unique_ptr<Tape> clone() const = 0;
+
+    // about how much memory the cells take
+    virtual size_t bytes() const = 0;
+};
+
+enum class TapeKind {
+    VECTOR,
+    // run-length encoded, for tapes with long stretches of the same letter
+    RLE,
+    // in a file, for tapes larger than the memory
+    MAPPED,
+    // in chunks shared with the clones, for runs forked many times
+    SHARED,
+};
+
+std::unique_ptr<Tape> make_tape(TapeKind kind);
+
+class VectorTape : public Tape {
+  public:
+    letter_id read(size_t pos) const override;
+
+    void write(size_t pos, letter_id letter) override;
+
+    size_t run_length(size_t pos, char direction) const override;
+
+    void reserve(size_t cells) override { cells_.reserve(cells); }
+
+    std::unique_ptr<Tape> clone() const override;
+
+    size_t bytes() const override {
+        return cells_.capacity() * sizeof(letter_id);
+    }
+
+  private:
+    std::vector<letter_id> cells_;
+};
+
+/**
+ * Keeps maximal runs of the same letter in a balanced tree, ordered by their
+ * first cells, so reading and writing any cell takes O(log runs),
+ * and O(1) when close to the previously accessed cell
+ */
+class RleTape : public Tape {
+  public:
+    RleTape();
+
+    letter_id read(size_t pos) const override;
+
+    void write(size_t pos, letter_id letter) override;
+
+    size_t run_length(size_t pos, char direction) const override;
+
+    std::unique_ptr<Tape> clone() const override;
+
+    size_t bytes() const override;
+
+  private:
+    struct Segment {
+        letter_id letter;
+        size_t length;
+    };
+
+    typedef std::map<size_t, Segment> Segments;
+
+    // the segment containing pos < end_
+    Segments::iterator find_(size_t pos) const;
+
+    // merges the segment with its neighbours holding the same letter
+    void merge_(Segments::iterator it);
+
+    // segments cover the cells [0, end_), all the next ones are blank
+    mutable Segments segments_;
+    size_t end_;
+
+    mutable Segments::iterator last_;
+};
+
+/**
+ * Keeps the cells in a sparse temporary file mapped into memory, so the pages
+ * not used lately are written back to the file instead of taking memory.
+ * The file grows in large steps; cells never written are holes in it,
+ * which read as blanks. Failing to create, grow or map the file throws
+ * std::system_error. The file is removed with the tape, so a checkpoint
+ * keeps a clone of it, in a file of its own
+ */
+class MappedTape : public Tape {
+  public:
+    MappedTape();
+
+    MappedTape(const MappedTape &) = delete;
+
+    ~MappedTape();
+
+    letter_id read(size_t pos) const override;
+
+    void write(size_t pos, letter_id letter) override;
+
+    size_t run_length(size_t pos, char direction) const override;
+
+    // into another file, sharing its blocks where the file system can
+    std::unique_ptr<Tape> clone() const override;
+
+    // as if all the cells written were in memory
+    size_t bytes() const override { return end_ * sizeof(letter_id); }
+
+    const std::string &filename() const { return filename_; }
+
+  private:
+    // makes the cell pos part of the file
+    void grow_(size_t pos);
+
+    std::string filename_;
+    int fd_;
+    letter_id *cells_;
+    // the number of cells in the file
+    size_t capacity_;
+    // the cells after the last one written are blank
+    size_t end_;
+};
+
+/**
+ * Keeps the cells in fixed-size chunks shared between a tape and its clones;
+ * a chunk is copied only when a tape writes to it while it is shared, so
+ * cloning costs one pointer per chunk, and a clone written near its head
+ * copies only the chunks it writes to
+ */
+class SharedTape : public Tape {
+  public:
+    SharedTape();
+
+    letter_id read(size_t pos) const override;
+
+    void write(size_t pos, letter_id letter) override;
+
+    size_t run_length(size_t pos, char direction) const override;
+
+    std::unique_ptr<Tape> clone() const override;
+
+    // as if none of the chunks were shared
+    size_t bytes() const override;
+
+  private:
+    static constexpr size_t CHUNK_CELLS = 1024;
+
+    typedef std::array<letter_id, CHUNK_CELLS> Chunk;
+
+    std::vector<std::shared_ptr<Chunk>> chunks_;
+    // the cells after the last one written are blank
+    size_t end_;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "timeline.h"
+
+#include <algorithm>
+
+using namespace std;
+
+Timeline::Timeline(Run &run, const TimelineLimits &limits)
+    : run_(run), spacing_(max<size_t>(limits.spacing, 1)),
+      memory_(limits.memory), bytes_(0) {
+    keep_checkpoint_();
+}
+
+size_t Timeline::seek(size_t step) {
+    step = max(step, checkpoints_.begin()->first);
+
+    // the checkpoints after the current step stay valid, the run being
+    // deterministic, so one of them may be closer going forward too
+    auto it = prev(checkpoints_.upper_bound(step));
+    if (step < run_.steps() || it->first > run_.steps())
+        run_.restore(it->second);
+
+    size_t from = run_.steps();
+    run_to_(step);
+    return run_.steps() - from;
+}
+
+void Timeline::run_to_(size_t step) {
+    while (run_.steps() < step && run_.verdict() == Verdict::RUNNING) {
+        size_t next = (run_.steps() / spacing_ + 1) * spacing_;
+        run_.run(min(step, next) - run_.steps());
+        if (run_.steps() % spacing_ == 0 && !checkpoints_.count(run_.steps()))
+            keep_checkpoint_();
+    }
+}
+
+void Timeline::keep_checkpoint_() {
+    Run::Checkpoint checkpoint = run_.checkpoint();
+    bytes_ += checkpoint.bytes();
+    checkpoints_.emplace(run_.steps(), move(checkpoint));
+
+    while (bytes_ > memory_ && checkpoints_.size() > 1) {
+        spacing_ *= 2;
+        for (auto it = next(checkpoints_.begin()); it != checkpoints_.end();) {
+            if (it->first % spacing_ == 0) {
+                ++it;
+                continue;
+            }
+            bytes_ -= it->second.bytes();
+            it = checkpoints_.erase(it);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef __TIMELINE_H
+#define __TIMELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+#include "interpreter.h"
+
+struct TimelineLimits {
+    // steps between two checkpoints, at first
+    size_t spacing = 1000000;
+    // the checkpoints are thinned out above that many bytes
+    size_t memory = size_t{256} << 20;
+};
+
+/**
+ * Brings a run to any of its steps, also backwards. While the run goes
+ * forward a checkpoint is kept every spacing steps; going to an earlier step
+ * restores the last checkpoint before it and replays the rest, so it takes
+ * at most spacing steps. Above the memory limit every other checkpoint is
+ * dropped and the spacing doubles.
+ */
+class Timeline {
+  public:
+    // the step the run is at is the earliest one it can be brought back to
+    Timeline(Run &run, const TimelineLimits &limits);
+
+    /**
+     * Brings the run to the step, or to the step where it halts before;
+     * returns the number of steps executed to get there
+     */
+    size_t seek(size_t step);
+
+    size_t spacing() const { return spacing_; }
+
+    size_t num_checkpoints() const { return checkpoints_.size(); }
+
+    size_t bytes() const { return bytes_; }
+
+  private:
+    // runs forward, keeping the checkpoints on the way
+    void run_to_(size_t step);
+
+    void keep_checkpoint_();
+
+    Run &run_;
+    size_t spacing_, memory_;
+    // taken by the checkpoints
+    size_t bytes_;
+    // by their steps, the first one is never dropped
+    std::map<size_t, Run::Checkpoint> checkpoints_;
+};
+
+#endif
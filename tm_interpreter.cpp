@@ -1,129 +1,621 @@
 #include <iostream>
-#include <sstream>
 #include <cstddef>
 #include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include "alloc_stats.h"
+#include "enumerator.h"
+#include "input_file.h"
+#include "interpreter.h"
+#include "machine_image.h"
+#include "ntm_engine.h"
+#include "scheduler.h"
+#include "sharded_runner.h"
+#include "timeline.h"
+#include "transition_store.h"
+#include "translator.h"
 #include "turing_machine.h"
 
 using namespace std;
 
 static bool verbose = true;
 
+// which configurations the verbose mode prints, and how much of them
+static struct {
+    size_t window = SIZE_MAX;
+    // every sample-th step, every step unless on_state_change is set
+    size_t sample = 0;
+    bool on_state_change = false;
+} view;
+
+static NtmLimits ntm_limits;
+
+// the nondeterministic machine indexed once, for all the lines of --serve
+static unique_ptr<NtmExplorer> ntm_explorer;
+
+static TapeKind tape_kind = TapeKind::VECTOR;
+
+// the length of the longest words --enumerate runs
+static size_t enumeration_length = 0;
+
+// the workers of --serve, none if it answers the lines itself
+static ShardedRunnerLimits sharded_runner_limits{.workers = 0};
+
+// --serve runs all the lines together, time_slice steps at a time, unless 0
+static struct {
+    size_t time_slice = 0;
+    bool first_accepting = false;
+} interleaving;
+
+// --debug moves the run back and forth through its steps, as stdin says
+static struct {
+    bool enabled = false;
+    TimelineLimits limits;
+} debugging;
+
+// runs the single tape translation of a machine, programming its states
+// only once some run reaches them; kept between the runs of --serve
+class LazyTranslation : public TransitionSource {
+  public:
+    LazyTranslation(const TuringMachine &tm) : translation_(tm, nullptr, Translation::LAZY) {}
+
+    int num_tapes() const override { return 1; }
+
+    const transitions_t::mapped_type *
+    find(const transitions_t::key_type &key) override {
+        return translation_.find_lazily(key);
+    }
+
+  private:
+    Translation translation_;
+};
+
+// where the runs look the transitions up instead of the parsed machine:
+// its lazy translation, its image shared by the workers, or a flat store
+static unique_ptr<TransitionSource> transitions;
+
 static void print_usage(string error) {
     cerr << "ERROR: " << error << "\n"
-         << "Usage: tm_interpreter [-q|--quiet] <input_file> <input>\n";
+         << "Usage: tm_interpreter [options] <input_file> <input>\n"
+         << "       tm_interpreter [options] --serve <input_file>\n"
+         << "       tm_interpreter [options] --input-file <file> <input_file>\n"
+         << "       tm_interpreter [options] --enumerate <n> <input_file>\n"
+         << "Options:\n"
+         << "  -q, --quiet\n"
+         << "  --window <n>               print only n cells around each "
+            "head\n"
+         << "  --sample <n>               print every n-th configuration\n"
+         << "  --on-state-change          print the configurations where the "
+            "state changes\n"
+         << "  --input-file <file>        read the input word from a file, or "
+            "stdin for -\n"
+         << "  --tape vector|rle|file     how the tapes are stored, file is "
+            "a temporary\n"
+         << "                             file in $TMPDIR\n"
+         << "  --translate-lazily         run the single tape translation of a "
+            "2-tape machine,\n"
+         << "                             translating only what the run "
+            "reaches\n"
+         << "  --memory-budget <bytes>    keep the transitions in a flat "
+            "store, spilling them\n"
+         << "                             to temporary files above the "
+            "budget\n"
+         << "  --nondeterministic         allow many transitions from the same "
+            "state and letters\n"
+         << "  --threads <n>              threads exploring a nondeterministic "
+            "machine\n"
+         << "  --max-steps <n>            give up exploring, or an interleaved "
+            "or enumerated\n"
+         << "                             run, after n steps\n"
+         << "  --max-configurations <n>   give up exploring after n distinct "
+            "configurations\n"
+         << "  --workers <n>              answer the lines of --serve in n "
+            "processes, quietly\n"
+         << "  --worker-memory <bytes>    the address space of each worker\n"
+         << "  --interleave <n>           run the lines of --serve together, n "
+            "steps at a time\n"
+         << "  --first-accepting          print only the first line accepted "
+            "by interleaved runs\n"
+         << "  --alloc-stats              print the allocations of each phase "
+            "to stderr\n"
+         << "  --debug                    read commands from stdin: step [n], "
+            "back [n],\n"
+         << "                             goto <n>, print, quit\n"
+         << "  --checkpoint-spacing <n>   steps between the checkpoints "
+            "kept by --debug\n"
+         << "  --checkpoint-memory <bytes>  memory of the checkpoints, "
+            "thinned out above it\n"
+         << "  --enumerate <n>            run all the words of at most n "
+            "letters, sharing\n"
+         << "                             the runs of their prefixes, and "
+            "count the verdicts\n";
     exit(1);
 }
 
-void halt(bool accept) {
-    cout << (accept ? "ACCEPT" : "REJECT") << "\n";
-    exit(0);
+static size_t parse_number(int argc, char *argv[], int &i) {
+    if (i + 1 >= argc)
+        print_usage(string("A number expected after ") + argv[i]);
+    string arg = argv[++i];
+    try {
+        size_t last;
+        unsigned long long res = stoull(arg, &last);
+        if (last == arg.length() && arg[0] != '-')
+            return res;
+    } catch (...) {
+    }
+    print_usage("Invalid number \"" + arg + "\"");
+    return 0;
+}
+
+static void print_debugged(const Run &run) {
+    cout << "Step " << run.steps() << "\n";
+    run.print_configuration(cout, view.window);
+    if (run.verdict() != Verdict::RUNNING)
+        cout << verdict_name(run.verdict())
+             << (run.halt_reason().empty() ? "" : " " + run.halt_reason())
+             << "\n";
+    cout.flush();
+}
+
+// going back costs at most the checkpoint spacing steps, not the whole run
+static string debug(Run &run) {
+    Timeline timeline(run, debugging.limits);
+    print_debugged(run);
+    string line;
+    while (getline(cin, line)) {
+        istringstream command(line);
+        string name, number;
+        command >> name >> number;
+        size_t n = 1;
+        try {
+            if (!number.empty())
+                n = stoull(number);
+        } catch (...) {
+            name.clear();
+        }
+
+        if (name == "q" || name == "quit")
+            break;
+        else if (name == "s" || name == "step")
+            timeline.seek(run.steps() + n);
+        else if (name == "b" || name == "back")
+            timeline.seek(run.steps() - min(n, run.steps()));
+        else if ((name == "g" || name == "goto") && !number.empty())
+            timeline.seek(n);
+        else if (name != "p" && name != "print") {
+            cout << "Commands: step [n], back [n], goto <n>, print, quit\n";
+            continue;
+        }
+        print_debugged(run);
+    }
+    return verdict_name(run.verdict());
+}
+
+static string execute(Run &run) {
+    if (debugging.enabled)
+        return debug(run);
+    if (!verbose) {
+        while (run.run() == Verdict::RUNNING)
+            ;
+        return verdict_name(run.verdict());
+    }
+
+    run.print_configuration(cerr, view.window);
+    string state = run.state();
+    size_t printed = 0, next_sample = view.sample;
+    while (run.verdict() == Verdict::RUNNING) {
+        // unless the state is watched, runs up to the next printed step at once
+        if (view.on_state_change || !view.sample)
+            run.execute_step();
+        else
+            run.run(next_sample - run.steps());
+
+        bool print = run.verdict() != Verdict::RUNNING;
+        if (view.sample && run.steps() >= next_sample) {
+            print = true;
+            next_sample = run.steps() + view.sample;
+        }
+        if (view.on_state_change && run.state() != state) {
+            print = true;
+            state = run.state();
+        }
+        if (print && run.steps() != printed) {
+            run.print_configuration(cerr, view.window);
+            printed = run.steps();
+        }
+    }
+    if (!run.halt_reason().empty())
+        cerr << run.halt_reason() << "\n";
+    return verdict_name(run.verdict());
+}
+
+// the runs look the transitions up in the store, the machine returned has none
+static TuringMachine read_tm_into_store(FILE *f, size_t memory_budget) {
+    // the store learns the number of tapes from the first transition
+    unique_ptr<TransitionStore> store;
+    TuringMachine tm = read_tm_from_file(
+        f, [&store, memory_budget](transitions_t::key_type key,
+                                   transitions_t::mapped_type target) {
+            if (!store)
+                store = make_unique<TransitionStore>(key.second.size(),
+                                                     memory_budget);
+            store->add(key.first, key.second, get<0>(target), get<1>(target),
+                       get<2>(target));
+            return true;
+        });
+    if (store) {
+        store->check();
+        transitions = move(store);
+    }
+    return tm;
+}
+
+static unique_ptr<Run>
+make_run(const TuringMachine &tm,
+         const function<size_t(LetterTable &, Tape &)> &write_input) {
+    if (transitions)
+        return make_unique<Run>(*transitions, write_input, tape_kind);
+    return make_unique<Run>(tm, write_input, tape_kind);
+}
+
+static unique_ptr<Run> make_run(const TuringMachine &tm,
+                                const vector<string> &input) {
+    if (transitions)
+        return make_unique<Run>(*transitions, input, tape_kind);
+    return make_unique<Run>(tm, input, tape_kind);
+}
+
+static string execute(const TuringMachine &tm, const vector<string> &input) {
+    AllocPhase setup("setup");
+    unique_ptr<Run> run = make_run(tm, input);
+    setup.end();
+    AllocPhase stepping("stepping");
+    return execute(*run);
+}
+
+// the input word never exists as strings, it goes straight onto the tape
+static int execute_input_file(const TuringMachine &tm,
+                              const string &input_filename) {
+    AllocPhase setup("setup");
+    InputFile input(input_filename, tm.input_alphabet());
+    if (!input.is_open()) {
+        cerr << "ERROR: File " << input_filename << " does not exist\n";
+        return 1;
+    }
+    unique_ptr<Run> run =
+        make_run(tm, [&input](LetterTable &letters, Tape &tape) {
+            return input.write(letters, tape);
+        });
+    if (input.invalid()) {
+        cerr << "ERROR: The input file is not a sequence of input letters\n";
+        return 1;
+    }
+    setup.end();
+    AllocPhase stepping("stepping");
+    cout << execute(*run) << "\n";
+    return 0;
 }
 
-vector<vector<string>> tapes;
-vector<size_t> heads;
-string state = INITIAL_STATE;
+static string execute(const NondeterministicTuringMachine &,
+                      const vector<string> &input) {
+    AllocPhase exploring("exploration");
+    NtmResult res = ntm_explorer->explore(input, verbose);
+    exploring.end();
+    if (res.verdict != Verdict::RUNNING)
+        return verdict_name(res.verdict);
+    if (verbose)
+        cerr << "Limit reached after " << res.steps << " steps and "
+             << res.configurations << " configurations\n";
+    return "UNKNOWN";
+}
 
-void append_blanks_under_heads() {
-    for (size_t a = 0; a < tapes.size(); ++a)
-        if (heads[a] >= tapes[a].size())
-            tapes[a].emplace_back(BLANK);
+template <typename M> static string answer(const M &tm, const string &line) {
+    vector<string> input = tm.parse_input(line);
+    if (input.empty() && line != "")
+        return "ERROR: Not a sequence of input letters";
+    return execute(tm, input);
 }
 
-void execute_step(const TuringMachine &tm) {
-    pair<string, vector<string>> cur;
-    cur.first = state;
-    for (size_t a = 0; a < tapes.size(); ++a)
-        cur.second.emplace_back(tapes[a][heads[a]]);
-    if (tm.transitions.find(cur) == tm.transitions.end()) {
-        if (verbose)
-            cerr << "No transition from this configuration\n";
-        halt(false);
+// prints the verdict of each word, then the numbers of the words of each
+// length the machine accepts
+static void execute_enumeration(const TuringMachine &tm) {
+    AllocPhase setup("setup");
+    unique_ptr<Run> run = make_run(tm, vector<string>());
+    setup.end();
+
+    AllocPhase stepping("stepping");
+    string line;
+    EnumerationStats stats = enumerate_words(
+        *run, tm.input_alphabet(), enumeration_length, ntm_limits.max_steps,
+        [&line](const vector<string> &word, Verdict verdict) {
+            line = verdict == Verdict::RUNNING ? "UNKNOWN" : verdict_name(verdict);
+            if (!word.empty())
+                line += " ";
+            for (const auto &letter : word)
+                line += letter;
+            line += "\n";
+            cout << line;
+        });
+    stepping.end();
+
+    size_t accepted = 0, rejected = 0, unknown = 0;
+    for (size_t a = 0; a <= enumeration_length; ++a) {
+        cout << "Length " << a << ": " << stats.accepted[a] << " accepted, "
+             << stats.rejected[a] << " rejected, " << stats.unknown[a]
+             << " unknown\n";
+        accepted += stats.accepted[a];
+        rejected += stats.rejected[a];
+        unknown += stats.unknown[a];
     }
-    auto trans = tm.transitions.at(cur);
-    state = get<0>(trans);
-    for (size_t a = 0; a < tapes.size(); ++a) {
-        tapes[a][heads[a]] = get<1>(trans)[a];
-        char dir = get<2>(trans)[a];
-        if (dir == HEAD_LEFT && !heads[a]) {
-            if (verbose)
-                cerr << "Head " << a + 1 << " falls off the tape in the next transition\n";
-            halt(false);
+    cout << "Total: " << accepted << " accepted, " << rejected << " rejected, "
+         << unknown << " unknown\n"
+         << "Steps: " << stats.steps << " executed, " << stats.separate_steps
+         << " in separate runs, " << stats.forks << " forks\n";
+}
+
+// reads all the lines first, then interleaves their runs on this thread
+static void serve_interleaved(const TuringMachine &tm) {
+    Scheduler scheduler(interleaving.time_slice);
+    vector<string> lines, answers;
+    vector<size_t> line_of_task;
+    string line;
+    AllocPhase setup("setup");
+    while (getline(cin, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        vector<string> input = tm.parse_input(line);
+        if (input.empty() && line != "")
+            answers.push_back("ERROR: Not a sequence of input letters");
+        else {
+            answers.push_back("");
+            scheduler.add(make_run(tm, input), 1, ntm_limits.max_steps);
+            line_of_task.push_back(lines.size());
         }
-        heads[a] += dir == HEAD_LEFT ? -1 : dir == HEAD_RIGHT ? 1 : 0;
+        lines.push_back(line);
     }
-    append_blanks_under_heads();
+    setup.end();
+
+    AllocPhase stepping("stepping");
+    const string *accepted = nullptr;
+    scheduler.run([&](Scheduler::TaskId id, const Run &run, TaskEnd end) {
+        size_t a = line_of_task[id];
+        answers[a] = end == TaskEnd::HALTED ? verdict_name(run.verdict())
+                                            : "UNKNOWN";
+        if (interleaving.first_accepting && !accepted &&
+            run.verdict() == Verdict::ACCEPT) {
+            accepted = &lines[a];
+            scheduler.cancel_all();
+        }
+    });
+
+    if (!interleaving.first_accepting) {
+        for (const auto &res : answers)
+            cout << res << "\n";
+    } else if (accepted)
+        cout << *accepted << "\n";
+    else
+        cout << "NONE\n";
 }
 
-void print_configuration() {
-    cerr << "State: " << state << "\n";
-    for (size_t a = 0; a < tapes.size(); ++a) {
-        size_t before_head = 0, after_head = 0;
-        ostringstream oss;
-        oss << "Tape " << (a + 1) << ": ";
-        for (size_t b = 0; b < tapes[a].size(); ++b) {
-            if (b == heads[a])
-                before_head = oss.str().length();
-            oss << tapes[a][b];
-            if (b == heads[a])
-                after_head = oss.str().length();
+// answers input words from stdin, one per line, keeping the machine parsed
+template <typename M> static void serve(const M &tm) {
+    if constexpr (is_same_v<M, TuringMachine>) {
+        if (interleaving.time_slice) {
+            serve_interleaved(tm);
+            return;
         }
-        cerr << oss.str() << "\n";
-        for (size_t b = 0; b < before_head; ++b)
-            cerr << " ";
-        for (size_t b = before_head; b < after_head; ++b)
-            cerr << "^";
-        cerr << "\n";
     }
-    cerr << "#####################################\n";
+    if (sharded_runner_limits.workers) {
+        run_sharded(cin, cout,
+                    [&tm](const string &line) { return answer(tm, line); },
+                    sharded_runner_limits);
+        return;
+    }
+
+    string line;
+    while (getline(cin, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        cout << answer(tm, line) << endl;
+    }
+}
+
+template <typename M>
+static int execute_machine(const M &tm, bool serve_mode, const string &input) {
+    if (serve_mode) {
+        serve(tm);
+        return 0;
+    }
+
+    vector<string> letters = tm.parse_input(input);
+    if (letters.empty() && input != "") {
+        cerr << "ERROR: The last argument is not a sequence of input letters\n";
+        return 1;
+    }
+    cout << execute(tm, letters) << "\n";
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
     string filename;
-    string input;
+    string input, input_filename;
+    bool serve_mode = false, nondeterministic = false, translate_lazily = false;
+    bool enumerate = false, tape_chosen = false;
+    size_t memory_budget = 0;
     int ok = 0;
     for (int i = 1; i < argc; i++) {
         string arg = argv[i];
         if (arg == "--quiet" || arg == "-q")
             verbose = false;
+        else if (arg == "--window")
+            view.window = parse_number(argc, argv, i);
+        else if (arg == "--sample") {
+            view.sample = parse_number(argc, argv, i);
+            if (!view.sample)
+                print_usage("--sample has to be positive");
+        }
+        else if (arg == "--on-state-change")
+            view.on_state_change = true;
+        else if (arg == "--serve")
+            serve_mode = true;
+        else if (arg == "--input-file") {
+            if (i + 1 >= argc)
+                print_usage("A file name expected after --input-file");
+            input_filename = argv[++i];
+        }
+        else if (arg == "--enumerate") {
+            enumeration_length = parse_number(argc, argv, i);
+            enumerate = true;
+        }
+        else if (arg == "--tape") {
+            tape_chosen = true;
+            string kind = i + 1 < argc ? argv[++i] : "";
+            if (kind == "vector")
+                tape_kind = TapeKind::VECTOR;
+            else if (kind == "rle")
+                tape_kind = TapeKind::RLE;
+            else if (kind == "file")
+                tape_kind = TapeKind::MAPPED;
+            else
+                print_usage("Tape kind expected after --tape: vector, rle or "
+                            "file");
+        }
+        else if (arg == "--translate-lazily")
+            translate_lazily = true;
+        else if (arg == "--memory-budget") {
+            memory_budget = parse_number(argc, argv, i);
+            if (!memory_budget)
+                print_usage("--memory-budget has to be positive");
+        }
+        else if (arg == "--nondeterministic")
+            nondeterministic = true;
+        else if (arg == "--threads")
+            ntm_limits.threads = parse_number(argc, argv, i);
+        else if (arg == "--max-steps")
+            ntm_limits.max_steps = parse_number(argc, argv, i);
+        else if (arg == "--max-configurations")
+            ntm_limits.max_configurations = parse_number(argc, argv, i);
+        else if (arg == "--workers") {
+            sharded_runner_limits.workers = parse_number(argc, argv, i);
+            if (!sharded_runner_limits.workers)
+                print_usage("--workers has to be positive");
+        }
+        else if (arg == "--interleave") {
+            interleaving.time_slice = parse_number(argc, argv, i);
+            if (!interleaving.time_slice)
+                print_usage("--interleave has to be positive");
+        }
+        else if (arg == "--first-accepting")
+            interleaving.first_accepting = true;
+        else if (arg == "--alloc-stats")
+            enable_alloc_stats();
+        else if (arg == "--debug")
+            debugging.enabled = true;
+        else if (arg == "--checkpoint-spacing") {
+            debugging.limits.spacing = parse_number(argc, argv, i);
+            if (!debugging.limits.spacing)
+                print_usage("--checkpoint-spacing has to be positive");
+        }
+        else if (arg == "--checkpoint-memory")
+            debugging.limits.memory = parse_number(argc, argv, i);
+        else if (arg == "--worker-memory")
+            sharded_runner_limits.worker_memory = parse_number(argc, argv, i);
         else {
             if (ok == 0)
                 filename = arg;
             else
-            if (ok == 1)
+            if (ok == 1 && !serve_mode && input_filename.empty())
                 input = arg;
             else
                 print_usage("Too many arguments");
             ++ok;
         }
     }
-    if (ok != 2)
+    if (!view.sample && !view.on_state_change)
+        view.sample = 1;
+    if (ok != (serve_mode || !input_filename.empty() || enumerate ? 1 : 2))
         print_usage("Not enough arguments");
+    if (!input_filename.empty() && (serve_mode || nondeterministic))
+        print_usage("--input-file works only for a single run of a "
+                    "deterministic machine");
+    if (sharded_runner_limits.workers) {
+        if (!serve_mode)
+            print_usage("--workers works only with --serve");
+        verbose = false;
+    }
+    if (interleaving.first_accepting && !interleaving.time_slice)
+        interleaving.time_slice = 1000;
+    if (interleaving.time_slice &&
+        (!serve_mode || nondeterministic || sharded_runner_limits.workers))
+        print_usage("--interleave works only with --serve, for a "
+                    "deterministic machine, without --workers");
+    if (interleaving.time_slice)
+        verbose = false;
+    if (translate_lazily && nondeterministic)
+        print_usage("--translate-lazily works only for deterministic machines");
+    if (memory_budget &&
+        (nondeterministic || translate_lazily || sharded_runner_limits.workers))
+        print_usage("--memory-budget cannot be used with --nondeterministic, "
+                    "--translate-lazily or --workers");
+    if (debugging.enabled && (serve_mode || nondeterministic))
+        print_usage("--debug works only for a single run of a deterministic "
+                    "machine");
+    if (debugging.enabled && input_filename == "-")
+        print_usage("--debug reads the commands from stdin, not the input");
+    if (enumerate && (serve_mode || nondeterministic ||
+                      !input_filename.empty() || debugging.enabled))
+        print_usage("--enumerate works only for a deterministic machine, "
+                    "without an input");
+    if (enumerate && tape_chosen)
+        print_usage("--enumerate keeps its own copy-on-write tapes");
+    // the runs are forked at every undetermined input cell they reach
+    if (enumerate)
+        tape_kind = TapeKind::SHARED;
 
     FILE *f = fopen(filename.c_str(), "r");
     if (!f) {
         cerr << "ERROR: File " << filename << " does not exist\n";
         return 1;
     }
-    TuringMachine tm = read_tm_from_file(f);
-    tapes.resize(tm.num_tapes);
-    heads.resize(tm.num_tapes);
-    tapes[0] = tm.parse_input(input);
-    if (tapes[0].empty() && input != "") {
-        cerr << "ERROR: The last argument is not a sequence of input letters\n";
-        return 1;
+    AllocPhase parsing("parse");
+    if (nondeterministic) {
+        NondeterministicTuringMachine ntm = read_ntm_from_file(f);
+        parsing.end();
+        ntm_explorer = make_unique<NtmExplorer>(ntm, ntm_limits);
+        return execute_machine(ntm, serve_mode, input);
     }
-    append_blanks_under_heads();
+    // a tape or a store in a file may fail to grow, e.g. with $TMPDIR full
+    try {
+        TuringMachine tm = memory_budget
+                               ? read_tm_into_store(f, memory_budget)
+                               : read_tm_from_file(f);
+        parsing.end();
+        if (translate_lazily) {
+            if (tm.num_tapes != 2) {
+                cerr << "ERROR: Only 2-tape machines can be translated\n";
+                return 1;
+            }
+            AllocPhase translating("translation");
+            transitions = make_unique<LazyTranslation>(tm);
+        }
+        // compiled before forking, so that every worker shares it
+        else if (sharded_runner_limits.workers) {
+            AllocPhase compiling("machine image");
+            transitions = make_unique<MachineImage>(tm);
+        }
 
-    if (verbose)
-        print_configuration();
-    for (;;) {
-        execute_step(tm);
-        if (verbose)
-            print_configuration();
-        if (state == REJECTING_STATE)
-            halt(false);
-        if (state == ACCEPTING_STATE)
-            halt(true);
-    }
-}
- 
+        if (!input_filename.empty())
+            return execute_input_file(tm, input_filename);
+        if (enumerate) {
+            execute_enumeration(tm);
+            return 0;
+        }
+        return execute_machine(tm, serve_mode, input);
+    } catch (const runtime_error &error) {
+        cout.flush();
+        cerr << "ERROR: " << error.what() << "\n";
+        return 1;
+    }
+}
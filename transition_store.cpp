@@ -0,0 +1,294 @@
+#include "transition_store.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+
+// output is collected into chunks of this size before writing it
+#define OUTPUT_CHUNK (1 << 20)
+
+// a lookup in a run reads at most this many lines
+#define RUN_INDEX_SPACING 64
+
+// the key of a line is everything before the space following the letters read
+static size_t key_length(std::string_view line, int num_tapes) {
+    size_t pos = 0;
+    for (int a = 0; a <= num_tapes; ++a) {
+        pos = line.find(' ', pos) + 1;
+    }
+    return pos - 1;
+}
+
+TransitionStore::TransitionStore(int num_tapes, size_t memory_budget)
+    : num_tapes_(num_tapes), memory_budget_(memory_budget), size_(0),
+      sorted_(true) {}
+
+TransitionStore::~TransitionStore() {
+    for (const auto &run : runs_) {
+        std::remove(run.path.c_str());
+    }
+}
+
+void TransitionStore::add(const std::string &state,
+                          const std::vector<std::string> &letters,
+                          const std::string &new_state,
+                          const std::vector<std::string> &new_letters,
+                          const std::string &directions) {
+    Entry entry;
+    entry.offset = lines_.size();
+
+    lines_ += state;
+    for (const auto &letter : letters) {
+        lines_ += ' ';
+        lines_ += letter;
+    }
+    entry.key_length = lines_.size() - entry.offset;
+    lines_ += ' ';
+    lines_ += new_state;
+    for (const auto &letter : new_letters) {
+        lines_ += ' ';
+        lines_ += letter;
+    }
+    for (char direction : directions) {
+        lines_ += ' ';
+        lines_ += direction;
+    }
+    lines_ += '\n';
+    entry.length = lines_.size() - entry.offset;
+
+    entries_.push_back(entry);
+    sorted_ = false;
+    ++size_;
+
+    if (lines_.size() + entries_.size() * sizeof(Entry) >= memory_budget_) {
+        spill_();
+    }
+}
+
+std::string_view TransitionStore::key_(const Entry &entry) const {
+    return std::string_view(lines_.data() + entry.offset, entry.key_length);
+}
+
+std::string_view TransitionStore::line_(const Entry &entry) const {
+    return std::string_view(lines_.data() + entry.offset, entry.length);
+}
+
+void TransitionStore::sort_() {
+    if (sorted_) {
+        return;
+    }
+    std::sort(entries_.begin(), entries_.end(),
+              [this](const Entry &a, const Entry &b) {
+                  return key_(a) < key_(b);
+              });
+    for (size_t a = 1; a < entries_.size(); ++a) {
+        if (key_(entries_[a - 1]) == key_(entries_[a])) {
+            throw std::runtime_error(
+                "The machine is not deterministic, two transitions from \"" +
+                std::string(key_(entries_[a])) + "\"");
+        }
+    }
+    sorted_ = true;
+}
+
+void TransitionStore::spill_() {
+    sort_();
+
+    std::ostringstream name;
+    name << "tm-transitions-" << getpid() << "-" << this << "-"
+         << runs_.size();
+    runs_.emplace_back();
+    SpilledRun &spilled = runs_.back();
+    spilled.path =
+        (std::filesystem::temp_directory_path() / name.str()).string();
+
+    std::ofstream run(spilled.path, std::ios::binary);
+    if (!run) {
+        throw std::system_error(errno, std::generic_category(),
+                                "Cannot create the run file " + spilled.path);
+    }
+    uint64_t offset = 0;
+    for (size_t a = 0; a < entries_.size(); ++a) {
+        const auto line = line_(entries_[a]);
+        if (a % RUN_INDEX_SPACING == 0) {
+            spilled.keys.emplace_back(key_(entries_[a]));
+            spilled.offsets.push_back(offset);
+        }
+        run.write(line.data(), line.size());
+        offset += line.size();
+    }
+    run.close();
+    if (run.fail()) {
+        throw std::system_error(errno, std::generic_category(),
+                                "Cannot write the run file " + spilled.path);
+    }
+
+    lines_.clear();
+    entries_.clear();
+}
+
+const transitions_t::mapped_type *
+TransitionStore::find(const transitions_t::key_type &key) {
+    key_buffer_ = key.first;
+    for (const auto &letter : key.second) {
+        key_buffer_ += ' ';
+        key_buffer_ += letter;
+    }
+    const std::string_view wanted(key_buffer_);
+
+    sort_();
+    const auto it = std::lower_bound(
+        entries_.begin(), entries_.end(), wanted,
+        [this](const Entry &entry, std::string_view value) {
+            return key_(entry) < value;
+        });
+    if (it != entries_.end() && key_(*it) == wanted) {
+        return parse_target_(line_(*it), it->key_length);
+    }
+
+    for (auto &run : runs_) {
+        // the last indexed line not after the key starts the lines to read
+        const size_t block =
+            std::upper_bound(run.keys.begin(), run.keys.end(), wanted) -
+            run.keys.begin();
+        if (!block) {
+            continue;
+        }
+        if (!run.file.is_open()) {
+            run.file.open(run.path, std::ios::binary);
+        }
+        run.file.clear();
+        run.file.seekg(run.offsets[block - 1]);
+        for (size_t a = 0; a < RUN_INDEX_SPACING; ++a) {
+            if (!std::getline(run.file, line_buffer_)) {
+                if (run.file.bad() || !run.file.is_open()) {
+                    throw std::system_error(
+                        errno, std::generic_category(),
+                        "Cannot read the run file " + run.path);
+                }
+                break;
+            }
+            const size_t length = key_length(line_buffer_, num_tapes_);
+            const std::string_view line_key =
+                std::string_view(line_buffer_).substr(0, length);
+            if (line_key == wanted) {
+                return parse_target_(line_buffer_, length);
+            }
+            if (line_key > wanted) {
+                break;
+            }
+        }
+    }
+    return nullptr;
+}
+
+const transitions_t::mapped_type *
+TransitionStore::parse_target_(std::string_view line, size_t key_length) {
+    size_t pos = key_length + 1;
+    const auto next_token = [&line, &pos] {
+        const size_t end = std::min(line.find_first_of(" \n", pos), line.size());
+        const std::string_view token = line.substr(pos, end - pos);
+        pos = end + 1;
+        return token;
+    };
+
+    std::get<0>(found_) = next_token();
+    std::get<1>(found_).resize(num_tapes_);
+    for (auto &letter : std::get<1>(found_)) {
+        letter = next_token();
+    }
+    std::get<2>(found_).clear();
+    for (int a = 0; a < num_tapes_; ++a) {
+        std::get<2>(found_) += next_token()[0];
+    }
+    return &found_;
+}
+
+void TransitionStore::check() {
+    merge_([](std::string_view) {});
+}
+
+void TransitionStore::save_to_file(
+    std::ostream &output, const std::vector<std::string> &input_alphabet) {
+    output << "num-tapes: " << num_tapes_ << "\ninput-alphabet:";
+    for (const auto &letter : input_alphabet) {
+        output << " " << letter;
+    }
+    output << "\n";
+
+    std::string chunk;
+    chunk.reserve(OUTPUT_CHUNK);
+    merge_([&](std::string_view line) {
+        chunk += line;
+        if (chunk.size() >= OUTPUT_CHUNK) {
+            output.write(chunk.data(), chunk.size());
+            chunk.clear();
+        }
+    });
+    output.write(chunk.data(), chunk.size());
+}
+
+void TransitionStore::merge_(
+    const std::function<void(std::string_view)> &write_line) {
+    if (runs_.empty()) {
+        sort_();
+        for (const auto &entry : entries_) {
+            write_line(line_(entry));
+        }
+        return;
+    }
+    if (!entries_.empty()) {
+        spill_();
+    }
+
+    // k-way merge of the runs, by the keys of their current lines
+    std::vector<std::ifstream> runs;
+    std::vector<std::string> lines(runs_.size());
+    for (const auto &run : runs_) {
+        runs.emplace_back(run.path, std::ios::binary);
+        if (!runs.back()) {
+            throw std::system_error(errno, std::generic_category(),
+                                    "Cannot read the run file " + run.path);
+        }
+    }
+    const auto key = [&](size_t run) {
+        return std::string_view(lines[run]).substr(
+            0, key_length(lines[run], num_tapes_));
+    };
+    const auto later = [&](size_t a, size_t b) { return key(a) > key(b); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heads(
+        later);
+    for (size_t a = 0; a < runs.size(); ++a) {
+        if (std::getline(runs[a], lines[a])) {
+            heads.push(a);
+        }
+    }
+
+    std::string previous_key;
+    while (!heads.empty()) {
+        const size_t run = heads.top();
+        heads.pop();
+        if (!previous_key.empty() && previous_key == key(run)) {
+            throw std::runtime_error(
+                "The machine is not deterministic, two transitions from \"" +
+                previous_key + "\"");
+        }
+        previous_key = key(run);
+
+        lines[run] += '\n';
+        write_line(lines[run]);
+        if (std::getline(runs[run], lines[run])) {
+            heads.push(run);
+        } else if (runs[run].bad()) {
+            throw std::system_error(errno, std::generic_category(),
+                                    "Cannot read the run file " +
+                                        runs_[run].path);
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef __TRANSITION_STORE_H
+#define __TRANSITION_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "interpreter.h"
+#include "turing_machine.h"
+
+/**
+ * A compact alternative to transitions_t for very large machines.
+ * Transitions are kept as their lines of text in one flat buffer, with an
+ * index of 16 bytes per transition, and are sorted only when needed.
+ * The lines sort in the same order as the keys of transitions_t, so the
+ * machine is written out exactly as TuringMachine::save_to_file would.
+ * Once the memory budget is exceeded, the transitions are sorted and spilled
+ * to a temporary file as a run; runs are merged when the machine is written.
+ * A transition is looked up by binary search, in memory and then in each
+ * run, through the keys of every few lines of the run kept in memory.
+ * Failing to write or read a run throws std::system_error, and two
+ * transitions from the same key throw std::runtime_error.
+ */
+class TransitionStore : public TransitionSource {
+  public:
+    TransitionStore(int num_tapes, size_t memory_budget);
+
+    TransitionStore(const TransitionStore &) = delete;
+
+    // removes the spilled runs
+    ~TransitionStore();
+
+    void add(const std::string &state, const std::vector<std::string> &letters,
+             const std::string &new_state,
+             const std::vector<std::string> &new_letters,
+             const std::string &directions);
+
+    size_t size() const { return size_; }
+
+    int num_tapes() const override { return num_tapes_; }
+
+    // the transition is valid until the next call
+    const transitions_t::mapped_type *
+    find(const transitions_t::key_type &key) override;
+
+    // throws std::runtime_error if two transitions have the same key,
+    // which is otherwise found only when writing them out
+    void check();
+
+    void save_to_file(std::ostream &output,
+                      const std::vector<std::string> &input_alphabet);
+
+  private:
+    struct Entry {
+        uint64_t offset;
+        uint32_t key_length, length;
+    };
+
+    std::string_view key_(const Entry &entry) const;
+
+    std::string_view line_(const Entry &entry) const;
+
+    // the target of the transition in line, into found_
+    const transitions_t::mapped_type *parse_target_(std::string_view line,
+                                                    size_t key_length);
+
+    void sort_();
+
+    void spill_();
+
+    // passes the lines in the order of their keys to write_line
+    void merge_(const std::function<void(std::string_view)> &write_line);
+
+    int num_tapes_;
+    size_t memory_budget_;
+    size_t size_;
+
+    // lines of the transitions, each ending with a newline
+    std::string lines_;
+    std::vector<Entry> entries_;
+    bool sorted_;
+
+    struct SpilledRun {
+        std::string path;
+        // the keys and the offsets of every RUN_INDEX_SPACING-th line
+        std::vector<std::string> keys;
+        std::vector<uint64_t> offsets;
+        // opened at the first lookup
+        std::ifstream file;
+    };
+
+    std::vector<SpilledRun> runs_;
+
+    std::string key_buffer_, line_buffer_;
+    transitions_t::mapped_type found_;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "translation_cache.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+// bump whenever the translation changes, so that stale entries are not used
+#define CACHE_VERSION "1"
+
+static uint64_t fnv1a(const std::string &data) {
+    uint64_t res = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        res = (res ^ c) * 1099511628211ULL;
+    }
+    return res;
+}
+
+static std::string read_file(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream res;
+    res << file.rdbuf();
+    return res.str();
+}
+
+TranslationCache::TranslationCache(const std::string &directory)
+    : directory_(directory) {
+    // if it cannot be created, every load misses and every store fails
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+}
+
+std::string TranslationCache::key(const TuringMachine &input,
+                                  const std::string &options) {
+    std::ostringstream res;
+    res << "version: " CACHE_VERSION "\noptions: " << options << "\n" << input;
+    return res.str();
+}
+
+std::string TranslationCache::path_(const std::string &key,
+                                    const std::string &suffix) const {
+    std::ostringstream res;
+    res << std::hex << fnv1a(key);
+    return (std::filesystem::path(directory_) / (res.str() + suffix)).string();
+}
+
+bool TranslationCache::load(const std::string &key,
+                            std::ostream &output) const {
+    // the full key is kept next to the translation, so that a collision
+    // of hashes is never taken for a hit
+    std::ifstream translation(path_(key, ".tm"), std::ios::binary);
+    if (!translation || read_file(path_(key, ".key")) != key) {
+        return false;
+    }
+    output << translation.rdbuf();
+    return true;
+}
+
+bool TranslationCache::store(
+    const std::string &key,
+    const std::function<void(std::ostream &)> &write_translation) {
+    // written under temporary names first, so that concurrent translators
+    // never see a half written entry
+    const std::string tmp_suffix = ".tmp" + std::to_string(getpid());
+    const std::string key_tmp = path_(key, ".key" + tmp_suffix);
+    const std::string translation_tmp = path_(key, ".tm" + tmp_suffix);
+    bool written;
+    {
+        std::ofstream key_file(key_tmp, std::ios::binary);
+        key_file << key;
+        std::ofstream translation(translation_tmp, std::ios::binary);
+        write_translation(translation);
+        // a short write, e.g. on a full disk, fails the stream
+        key_file.close();
+        translation.close();
+        written = !key_file.fail() && !translation.fail();
+    }
+
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(key_tmp, path_(key, ".key"), error);
+        if (!error) {
+            std::filesystem::rename(translation_tmp, path_(key, ".tm"), error);
+            // the key alone would stand for the translation of another one
+            if (error) {
+                std::filesystem::remove(path_(key, ".key"), error);
+                error = std::make_error_code(std::errc::io_error);
+            }
+        }
+    }
+    if (!written || error) {
+        std::filesystem::remove(key_tmp, error);
+        std::filesystem::remove(translation_tmp, error);
+        return false;
+    }
+    return true;
+}
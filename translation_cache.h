@@ -0,0 +1,39 @@
+#ifndef __TRANSLATION_CACHE_H
+#define __TRANSLATION_CACHE_H
+
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "turing_machine.h"
+
+/**
+ * A directory of translated machines, addressed by a hash of the parsed input
+ * machine and of the translator options. As the machine is hashed after
+ * parsing, comments, whitespace and the order of transitions do not matter.
+ */
+class TranslationCache {
+  public:
+    TranslationCache(const std::string &directory);
+
+    // canonical description of what is translated
+    static std::string key(const TuringMachine &input,
+                           const std::string &options);
+
+    // copies the cached translation to output, returns false on a miss
+    bool load(const std::string &key, std::ostream &output) const;
+
+    /**
+     * Stores the bytes written by write_translation under key; returns false
+     * if they could not all be written, leaving the cache as it was
+     */
+    bool store(const std::string &key,
+               const std::function<void(std::ostream &)> &write_translation);
+
+  private:
+    std::string path_(const std::string &key, const std::string &suffix) const;
+
+    std::string directory_;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "translation_estimate.h"
+
+#include <cassert>
+#include <unordered_set>
+
+#include "binary_translator.h"
+
+// typical lengths of generated identifiers, such as "(marking_head1f)"
+#define STATE_NAME_LENGTH 20
+
+// a node of transitions_t holding a 1-tape transition, with the vectors,
+// the long state names and the allocator overhead, measured with glibc
+#define BYTES_PER_TRANSITION 360
+
+TranslationEstimate estimate_translation(const TuringMachine &input) {
+    assert(input.num_tapes == 2);
+
+    // the counts follow what each program_* method of Translation generates
+    const size_t g = input.working_alphabet().size();
+    const size_t s = input.input_alphabet().size();
+
+    // states that are simulated, i.e. all but accepting and rejecting
+    const size_t q = input.set_of_states().size() - 2;
+
+    size_t halting = 0, moving = 0, moves_right = 0;
+    for (const auto &[key, target] : input.transitions()) {
+        const auto &target_state = std::get<0>(target);
+        if (target_state == ACCEPTING_STATE ||
+            target_state == REJECTING_STATE) {
+            ++halting;
+        } else {
+            ++moving;
+            for (char move : std::get<2>(target)) {
+                moves_right += move == HEAD_RIGHT;
+            }
+        }
+    }
+
+    TranslationEstimate res;
+
+    // encodings of pairs of letters, the tape start, the blank and the input
+    res.letters = 4 * g * g + 2 + s;
+
+    // setup, simulated states found by scanning,
+    // scanning and going back for each state, helpers for each transition
+    res.states = 3 + 1 + 2 * s + q * (g * g + 2 * g + 2) + 10 * moving;
+
+    res.transitions = (3 + 3 * s + 2 * s * s) + q * (4 * g * g + 4 * g * g * g) +
+                      q * (4 * g * g + 1) + halting * (2 * g + 1) +
+                      moving * (12 * g * g + 14 * g + 1) + 2 * moves_right;
+
+    // an encoding is the pair of letters with "-", the brackets and "_H"s
+    size_t letters_length = 0;
+    for (const auto &letter : input.working_alphabet()) {
+        letters_length += letter.length();
+    }
+    const size_t letter_name_length = 2 * letters_length / g + 5;
+
+    res.output_bytes =
+        res.transitions * (2 * STATE_NAME_LENGTH + 2 * letter_name_length + 6);
+
+    // the generated transitions are moved, not copied, into the result
+    res.peak_memory_bytes = res.transitions * BYTES_PER_TRANSITION;
+
+    // scanning to the second head found, back to the first one,
+    // and back to the start
+    res.cells_per_cell = 1;
+    res.sweeps_per_step = 3;
+
+    return res;
+}
+
+TranslationEstimate estimate_binary_translation(const TuringMachine &input) {
+    BinaryTranslation translation(input);
+    const size_t block_width = translation.block_width();
+    const TuringMachine translated = translation.result();
+
+    std::unordered_set<std::string> letters(translated.input_alphabet().begin(),
+                                            translated.input_alphabet().end());
+    std::unordered_set<std::string> states;
+    TranslationEstimate res{};
+    res.output_bytes = std::string("num-tapes: 1\ninput-alphabet:\n").length();
+    for (const auto &letter : translated.input_alphabet()) {
+        res.output_bytes += letter.length() + 1;
+    }
+    for (const auto &[key, target] : translated.transitions()) {
+        states.insert(key.first);
+        states.insert(std::get<0>(target));
+        letters.insert(key.second[0]);
+        letters.insert(std::get<1>(target)[0]);
+        // the names, the spaces, the move and the newline
+        res.output_bytes += key.first.length() + key.second[0].length() +
+                            std::get<0>(target).length() +
+                            std::get<1>(target)[0].length() + 6;
+    }
+    letters.insert(BLANK);
+
+    res.letters = letters.size();
+    res.states = states.size();
+    res.transitions = translated.transitions().size();
+    res.peak_memory_bytes = res.transitions * BYTES_PER_TRANSITION;
+
+    // to the top head and back, to the bottom head and back,
+    // and to the top head and back again
+    res.cells_per_cell = block_width;
+    res.sweeps_per_step = 6;
+
+    return res;
+}
+
+std::ostream &operator<<(std::ostream &output,
+                         const TranslationEstimate &estimate) {
+    print_estimate(output, estimate, "");
+    return output;
+}
+
+void print_estimate(std::ostream &output, const TranslationEstimate &estimate,
+                    const std::string &prefix) {
+    output << prefix << "letters: " << estimate.letters << "\n"
+           << prefix << "states: " << estimate.states << "\n"
+           << prefix << "transitions: " << estimate.transitions << "\n"
+           << prefix << "output-bytes: " << estimate.output_bytes << "\n"
+           << prefix << "peak-memory-bytes: " << estimate.peak_memory_bytes
+           << "\n"
+           << prefix << "cells-per-cell: " << estimate.cells_per_cell << "\n"
+           << prefix << "sweeps-per-step: " << estimate.sweeps_per_step
+           << "\n";
+}
@@ -0,0 +1,44 @@
+#ifndef __TRANSLATION_ESTIMATE_H
+#define __TRANSLATION_ESTIMATE_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "turing_machine.h"
+
+struct TranslationEstimate {
+    // exact sizes of the translated machine
+    size_t letters, states, transitions;
+
+    // approximations, generated names are assumed to be of a typical length
+    size_t output_bytes, peak_memory_bytes;
+
+    // cells of the tape per simulated cell, and passes over the used part of
+    // the tape per simulated step at most: the cost of a step is about
+    // their product times the number of simulated cells
+    size_t cells_per_cell, sweeps_per_step;
+};
+
+/**
+ * Computes the size of the translation of a 2-tape machine without doing it,
+ * in O(|transitions| + |alphabet| + |states|)
+ */
+TranslationEstimate estimate_translation(const TuringMachine &input);
+
+/**
+ * The same for BinaryTranslation. Its sub-machines are shared by the states
+ * they lead to, so there is no closed form for their number: the translation
+ * is done, which makes the sizes and the output bytes exact, but costs as
+ * much as translating, so it is computed only on request
+ */
+TranslationEstimate estimate_binary_translation(const TuringMachine &input);
+
+// one "<prefix><name>: <value>" line per field
+void print_estimate(std::ostream &output, const TranslationEstimate &estimate,
+                    const std::string &prefix);
+
+std::ostream &operator<<(std::ostream &output,
+                         const TranslationEstimate &estimate);
+
+#endif
@@ -1,7 +1,24 @@
 #include "translator.h"
 
-Translation::Translation(const TuringMachine &input)
-    : input_(input),
+#include <algorithm>
+#include <stdexcept>
+
+#include "alloc_stats.h"
+
+#define NOT_A_PREVIOUS_TRANSLATION                                             \
+    "The previous output is not a translation of the previous input made "     \
+    "without --compact-names or --compress-alphabet"
+
+Translation::Translation(const TuringMachine &input, TransitionStore *store,
+                         unsigned flags)
+    : classes_(flags & COMPRESS_ALPHABET
+                   ? std::make_unique<AlphabetClasses>(
+                         compute_alphabet_classes(input))
+                   : nullptr),
+      input_(classes_ ? classes_->quotient : input),
+      input_alphabet_(input.input_alphabet()), store_(store),
+      lazy_(flags & LAZY),
+      share_submachines_(flags & SHARE_SUBMACHINES),
       // we cannot allow for those identifiers to be generated
       states_(std::vector<std::string>{INITIAL_STATE, ACCEPTING_STATE,
                                        REJECTING_STATE}),
@@ -9,16 +26,186 @@ Translation::Translation(const TuringMachine &input)
       letters_map_(create_double_letters_()),
       importandt_idents_(create_important_idents_()),
       state_aliases_(create_state_aliases_()) {
+    assert(!(store && lazy_));
 
+    AllocPhase setup("setup protocol");
     program_setup_protocol_();
+    setup.end();
+
+    if (lazy_) {
+        // every other transition leads through one of those states
+        for (const auto &[old_state_ident, state_alias] : state_aliases_) {
+            pending_[state_alias.do_scanning] = [this, old_state_ident,
+                                                 state_alias] {
+                program_scanning_state_(old_state_ident,
+                                        state_alias.do_scanning);
+            };
+            pending_[state_alias.going_back] = [this, state_alias] {
+                program_going_back_(state_alias);
+            };
+        }
+        return;
+    }
 
+    AllocPhase scanning("scanning states");
     program_scanning_for_letters_();
+    scanning.end();
 
+    AllocPhase transitions("simulated transitions");
     program_transitions_();
+    transitions.end();
 
+    AllocPhase cleanup("cleanup");
     program_cleanup_();
 }
 
+Translation::Translation(const TuringMachine &input,
+                         const TuringMachine &previous_input,
+                         TuringMachine previous_output)
+    : input_(input), input_alphabet_(input.input_alphabet()), store_(nullptr),
+      lazy_(false), share_submachines_(false),
+      // the same names as in the previous translation get generated here
+      states_(std::vector<std::string>{INITIAL_STATE, ACCEPTING_STATE,
+                                       REJECTING_STATE}),
+      letters_(input.working_alphabet()),
+      letters_map_(create_double_letters_()),
+      importandt_idents_(create_important_idents_()),
+      state_aliases_(create_state_aliases_()),
+      res_transitions_(previous_output.take_transitions()) {
+    assert(can_translate_incrementally(input, previous_input));
+
+    // new helper states cannot collide with any state of the previous output;
+    // the same walk counts what leads to each state, see erase_simulated_state_
+    for (const auto &[key, target] : res_transitions_) {
+        const State &next = std::get<0>(target);
+        states_.insert(key.first);
+        states_.insert(next);
+        if (next != key.first) {
+            ++references_[next];
+        }
+    }
+    check_previous_output_();
+
+    // a translation leaves unreachable the states marking a head which
+    // stays, what leads from them is not counted
+    std::vector<State> unreachable;
+    const State *last = nullptr;
+    for (const auto &[key, target] : res_transitions_) {
+        if (last && *last == key.first) {
+            continue;
+        }
+        last = &key.first;
+        if (key.first != INITIAL_STATE && !references_.count(key.first)) {
+            unreachable.push_back(key.first);
+        }
+    }
+    while (!unreachable.empty()) {
+        const State state = std::move(unreachable.back());
+        unreachable.pop_back();
+        for (auto it = res_transitions_.lower_bound(
+                 std::make_pair(state, std::vector<std::string>{}));
+             it != res_transitions_.end() && it->first.first == state; ++it) {
+            const State &next = std::get<0>(it->second);
+            if (next != state && !--references_[next]) {
+                unreachable.push_back(next);
+            }
+        }
+    }
+
+    // collected once, each changed simulated state only looks them up
+    kept_ = {ACCEPTING_STATE, REJECTING_STATE};
+    for (const auto &[old_state_ident, state_alias] : state_aliases_) {
+        kept_.insert(state_alias.do_scanning);
+        kept_.insert(state_alias.going_back);
+    }
+
+    // both machines have the same states, so the same state ids; only the
+    // states whose transitions differ are walked through
+    std::vector<transitions_t::key_type> changed;
+    const auto &old_ranges = previous_input.index().state_transitions;
+    const auto &new_ranges = input.index().state_transitions;
+    for (size_t a = 0; a < new_ranges.size(); ++a) {
+        auto [old_it, old_end] = old_ranges[a];
+        auto [new_it, new_end] = new_ranges[a];
+        if (std::equal(old_it, old_end, new_it, new_end)) {
+            continue;
+        }
+        while (old_it != old_end || new_it != new_end) {
+            if (new_it == new_end ||
+                (old_it != old_end && old_it->first < new_it->first)) {
+                changed.push_back((old_it++)->first);
+            } else if (old_it == old_end || new_it->first < old_it->first) {
+                changed.push_back((new_it++)->first);
+            } else {
+                if (old_it->second != new_it->second) {
+                    changed.push_back(new_it->first);
+                }
+                ++old_it;
+                ++new_it;
+            }
+        }
+    }
+
+    for (const auto &[state, letters] : changed) {
+        const auto data = SimulatedState{
+            .state = state,
+            .top_letter = letters[0],
+            .bottom_letter = letters[1],
+        };
+
+        // scanning leads to the simulated state once both heads are found
+        const auto alias_it = res_transitions_.find(std::make_pair(
+            state_aliases_[state].do_scanning,
+            std::vector{letters_map_[std::make_pair(data.top_letter,
+                                                    data.bottom_letter)]
+                            .both_heads}));
+        if (alias_it == res_transitions_.end()) {
+            throw std::runtime_error(NOT_A_PREVIOUS_TRANSLATION);
+        }
+        const State alias = std::get<0>(alias_it->second);
+
+        simulated_states_[data] = alias;
+        erase_simulated_state_(alias);
+        program_simulated_state_(data, alias);
+    }
+}
+
+void Translation::check_previous_output_() const {
+    // every simulated state goes back to the start of the tape, and then
+    // scans it, under the names generated again here
+    for (const auto &[old_state_ident, state_alias] : state_aliases_) {
+        const auto it = res_transitions_.find(std::make_pair(
+            state_alias.going_back,
+            std::vector{importandt_idents_.letter_tape_start}));
+        if (it == res_transitions_.end() ||
+            it->second !=
+                std::make_tuple(
+                    state_alias.do_scanning,
+                    std::vector{importandt_idents_.letter_tape_start},
+                    std::string{HEAD_RIGHT})) {
+            throw std::runtime_error(NOT_A_PREVIOUS_TRANSLATION);
+        }
+    }
+
+    // and the scanning reads every pair of letters, which a compressed
+    // alphabet would lack
+    for (const auto &[letter_pair, letter_encoding] : letters_map_) {
+        if (!res_transitions_.count(
+                std::make_pair(importandt_idents_.semi_start,
+                               std::vector{letter_encoding.no_head}))) {
+            throw std::runtime_error(NOT_A_PREVIOUS_TRANSLATION);
+        }
+    }
+}
+
+bool Translation::can_translate_incrementally(
+    const TuringMachine &input, const TuringMachine &previous_input) {
+    return input.num_tapes == 2 && previous_input.num_tapes == 2 &&
+           input.input_alphabet() == previous_input.input_alphabet() &&
+           input.working_alphabet() == previous_input.working_alphabet() &&
+           input.set_of_states() == previous_input.set_of_states();
+}
+
 Translation::LettersMap Translation::create_double_letters_() {
     LettersMap res;
     for (const Letter &letter_top : input_.working_alphabet()) {
@@ -83,13 +270,22 @@ void Translation::program_setup_protocol_() {
                     state_aliases_[INITIAL_STATE].do_scanning,
                     importandt_idents_.letter_tape_start, HEAD_RIGHT);
 
-    for (const Letter &letter : input_.input_alphabet) {
+    // the letters of the input written as each letter of the translated
+    // machine, differing only with a compressed alphabet
+    std::unordered_map<Letter, std::vector<Letter>> input_letters;
+    for (const Letter &letter : input_alphabet_) {
+        input_letters[letter_class_(letter)].push_back(letter);
+    }
+
+    for (const Letter &letter : input_.input_alphabet()) {
         const State move_curr_letter =
             states_.generate("setup-move-1st-" + letter);
         moing_first_letter.push_back(std::make_pair(letter, move_curr_letter));
 
-        new_transition_(INITIAL_STATE, letter, move_curr_letter,
-                        importandt_idents_.letter_tape_start, HEAD_RIGHT);
+        for (const Letter &read_letter : input_letters[letter]) {
+            new_transition_(INITIAL_STATE, read_letter, move_curr_letter,
+                            importandt_idents_.letter_tape_start, HEAD_RIGHT);
+        }
     }
 
     std::unordered_map<Letter, State> moving_letter;
@@ -101,31 +297,36 @@ void Translation::program_setup_protocol_() {
             HEAD_LEFT);
     }
 
-    for (const Letter &letter : input_.input_alphabet) {
+    for (const Letter &letter : input_.input_alphabet()) {
 
         const auto moving_letter_state =
             states_.generate("setup-move-" + letter);
         moving_letter[letter] = moving_letter_state;
 
         for (const auto &[letter_to_write, state] : moing_first_letter) {
-            new_transition_(
-                state, letter, moving_letter_state,
-                letters_map_[std::make_pair(letter_to_write, BLANK)].both_heads,
-                HEAD_RIGHT);
+            for (const Letter &read_letter : input_letters[letter]) {
+                new_transition_(
+                    state, read_letter, moving_letter_state,
+                    letters_map_[std::make_pair(letter_to_write, BLANK)]
+                        .both_heads,
+                    HEAD_RIGHT);
+            }
         }
     }
 
-    for (const Letter &letter_moved : input_.input_alphabet) {
-        for (const Letter &curr_letter : input_.input_alphabet) {
-            new_transition_(
-                moving_letter[letter_moved], curr_letter,
-                moving_letter[curr_letter],
-                letters_map_[std::make_pair(letter_moved, BLANK)].no_head,
-                HEAD_RIGHT);
+    for (const Letter &letter_moved : input_.input_alphabet()) {
+        for (const Letter &curr_letter : input_.input_alphabet()) {
+            for (const Letter &read_letter : input_letters[curr_letter]) {
+                new_transition_(
+                    moving_letter[letter_moved], read_letter,
+                    moving_letter[curr_letter],
+                    letters_map_[std::make_pair(letter_moved, BLANK)].no_head,
+                    HEAD_RIGHT);
+            }
         }
     }
 
-    for (const Letter &letter_moved : input_.input_alphabet) {
+    for (const Letter &letter_moved : input_.input_alphabet()) {
         new_transition_(
             moving_letter[letter_moved], BLANK,
             state_aliases_[INITIAL_STATE].going_back,
@@ -140,105 +341,165 @@ void Translation::program_scanning_for_letters_() {
         found_letter_encoding;
 
     for (const auto &[old_state_ident, state_alias] : state_aliases_) {
+        program_scanning_state_(old_state_ident, state_alias.do_scanning);
+    }
+}
 
-        for (const auto &[letter_pair, letter_encoding] : letters_map_) {
-            new_transition_(state_alias.do_scanning, letter_encoding.no_head,
-                            state_alias.do_scanning, letter_encoding.no_head,
-                            HEAD_RIGHT);
-
-            const State simualted_state =
-                create_or_get_simulated_state_alias_(SimulatedState{
-                    .state = old_state_ident,
-                    .top_letter = letter_pair.first,
-                    .bottom_letter = letter_pair.second,
-                });
-
-            new_transition_(state_alias.do_scanning, letter_encoding.both_heads,
-                            simualted_state, letter_encoding.both_heads,
-                            HEAD_STAY);
-        }
-        program_scanning_letters_<TopHead>(state_alias.do_scanning,
-                                           old_state_ident);
-        program_scanning_letters_<BottomHead>(state_alias.do_scanning,
-                                              old_state_ident);
+void Translation::program_scanning_state_(const State &old_state_ident,
+                                          const State &do_scanning) {
+    for (const auto &[letter_pair, letter_encoding] : letters_map_) {
+        new_transition_(do_scanning, letter_encoding.no_head, do_scanning,
+                        letter_encoding.no_head, HEAD_RIGHT);
+
+        const State simualted_state =
+            create_or_get_simulated_state_alias_(SimulatedState{
+                .state = old_state_ident,
+                .top_letter = letter_pair.first,
+                .bottom_letter = letter_pair.second,
+            });
+
+        new_transition_(do_scanning, letter_encoding.both_heads,
+                        simualted_state, letter_encoding.both_heads, HEAD_STAY);
     }
+    program_scanning_letters_<TopHead>(do_scanning, old_state_ident);
+    program_scanning_letters_<BottomHead>(do_scanning, old_state_ident);
 }
 
 void Translation::program_transitions_() {
     for (const auto &[data, input_state_alias] : simulated_states_) {
+        program_simulated_state_(data, input_state_alias);
+    }
+}
 
-        const auto target_it = input_.transitions.find(std::make_pair(
-            data.state, std::vector{data.top_letter, data.bottom_letter}));
+void Translation::program_simulated_state_(const SimulatedState &data,
+                                           const State &input_state_alias) {
+    const auto target_it = input_.transitions().find(std::make_pair(
+        data.state, std::vector{data.top_letter, data.bottom_letter}));
 
-        if (target_it == input_.transitions.end()) {
-            continue;
-        }
+    if (target_it == input_.transitions().end()) {
+        return;
+    }
 
-        const auto &target_state = std::get<0>(target_it->second);
-        if (target_state == ACCEPTING_STATE ||
-            target_state == REJECTING_STATE) {
-            program_reject_accept_(data, input_state_alias, target_state);
-            continue;
-        }
+    const auto &target_state = std::get<0>(target_it->second);
+    if (target_state == ACCEPTING_STATE || target_state == REJECTING_STATE) {
+        program_reject_accept_(data, input_state_alias, target_state);
+        return;
+    }
 
-        const auto target_data = TransitionTarget{
-            .target_state = target_state,
-            .top_letter = std::get<1>(target_it->second)[0],
-            .bottom_letter = std::get<1>(target_it->second)[1],
-            .top_head_move = std::get<2>(target_it->second)[0],
-            .bottom_head_move = std::get<2>(target_it->second)[1]};
-
-        const State move_top_first = states_.generate();
-        const State move_bottom_first = states_.generate();
-
-        for (const Letter &letter : input_.working_alphabet()) {
-            new_transition_(
-                input_state_alias,
-                letters_map_[std::make_pair(data.top_letter, letter)].top_head,
-                move_top_first,
-                letters_map_[std::make_pair(data.top_letter, letter)].top_head,
-                HEAD_STAY);
-            new_transition_(
-                input_state_alias,
-                letters_map_[std::make_pair(letter, data.bottom_letter)]
-                    .bottom_head,
-                move_bottom_first,
-                letters_map_[std::make_pair(letter, data.bottom_letter)]
-                    .bottom_head,
-                HEAD_STAY);
-        }
+    const auto target_data = TransitionTarget{
+        .target_state = target_state,
+        .top_letter = std::get<1>(target_it->second)[0],
+        .bottom_letter = std::get<1>(target_it->second)[1],
+        .top_head_move = std::get<2>(target_it->second)[0],
+        .bottom_head_move = std::get<2>(target_it->second)[1]};
+
+    if (share_submachines_) {
+        // built from the last sub-machine, so that equal tails are shared
+        const State &going_back =
+            state_aliases_[target_data.target_state].going_back;
+        const State move_top_first = shared_move_<TopHead>(
+            target_data.top_letter, target_data.top_head_move, data.top_letter,
+            shared_look_for_head_<BottomHead>(
+                data.bottom_letter,
+                shared_move_<BottomHead>(target_data.bottom_letter,
+                                         target_data.bottom_head_move,
+                                         data.bottom_letter, going_back)));
+        const State move_bottom_first = shared_move_<BottomHead>(
+            target_data.bottom_letter, target_data.bottom_head_move,
+            data.bottom_letter,
+            shared_look_for_head_<TopHead>(
+                data.top_letter,
+                shared_move_<TopHead>(target_data.top_letter,
+                                      target_data.top_head_move,
+                                      data.top_letter, going_back)));
+        program_moving_first_(data, input_state_alias, move_top_first,
+                              move_bottom_first);
+        return;
+    }
+
+    const State move_top_first = states_.generate();
+    const State move_bottom_first = states_.generate();
+    program_moving_first_(data, input_state_alias, move_top_first,
+                          move_bottom_first);
+
+    State intermiediate = states_.generate("intemediate_top_bottom");
+    const State found_bottom = states_.generate("found_bottom_head");
+    program_move_<Translation::TopHead>(
+        target_data.top_letter, target_data.top_head_move, data.top_letter,
+        move_top_first, intermiediate);
+    program_look_for_head_<Translation::BottomHead>(
+        data.bottom_letter, intermiediate, found_bottom);
+    program_move_<Translation::BottomHead>(
+        target_data.bottom_letter, target_data.bottom_head_move,
+        data.bottom_letter, found_bottom,
+        state_aliases_[target_data.target_state].going_back);
+
+    const State found_top = states_.generate("found_top_head");
+    intermiediate = states_.generate("intermediate_bottom_top");
+    program_move_<Translation::BottomHead>(
+        target_data.bottom_letter, target_data.bottom_head_move,
+        data.bottom_letter, move_bottom_first, intermiediate);
+    program_look_for_head_<Translation::TopHead>(data.top_letter,
+                                                 intermiediate, found_top);
+    program_move_<Translation::TopHead>(
+        target_data.top_letter, target_data.top_head_move, data.top_letter,
+        found_top, state_aliases_[target_data.target_state].going_back);
+}
 
+void Translation::program_moving_first_(const SimulatedState &data,
+                                        const State &input_state_alias,
+                                        const State &move_top_first,
+                                        const State &move_bottom_first) {
+    for (const Letter &letter : input_.working_alphabet()) {
         new_transition_(
             input_state_alias,
-            letters_map_[std::make_pair(data.top_letter, data.bottom_letter)]
-                .both_heads,
+            letters_map_[std::make_pair(data.top_letter, letter)].top_head,
             move_top_first,
-            letters_map_[std::make_pair(data.top_letter, data.bottom_letter)]
-                .both_heads,
+            letters_map_[std::make_pair(data.top_letter, letter)].top_head,
             HEAD_STAY);
+        new_transition_(
+            input_state_alias,
+            letters_map_[std::make_pair(letter, data.bottom_letter)]
+                .bottom_head,
+            move_bottom_first,
+            letters_map_[std::make_pair(letter, data.bottom_letter)]
+                .bottom_head,
+            HEAD_STAY);
+    }
 
-        State intermiediate = states_.generate("intemediate_top_bottom");
-        const State found_bottom = states_.generate("found_bottom_head");
-        program_move_<Translation::TopHead>(
-            target_data.top_letter, target_data.top_head_move, data.top_letter,
-            move_top_first, intermiediate);
-        program_look_for_head_<Translation::BottomHead>(
-            data.bottom_letter, intermiediate, found_bottom);
-        program_move_<Translation::BottomHead>(
-            target_data.bottom_letter, target_data.bottom_head_move,
-            data.bottom_letter, found_bottom,
-            state_aliases_[target_data.target_state].going_back);
+    new_transition_(
+        input_state_alias,
+        letters_map_[std::make_pair(data.top_letter, data.bottom_letter)]
+            .both_heads,
+        move_top_first,
+        letters_map_[std::make_pair(data.top_letter, data.bottom_letter)]
+            .both_heads,
+        HEAD_STAY);
+}
 
-        const State found_top = states_.generate("found_top_head");
-        intermiediate = states_.generate("intermediate_bottom_top");
-        program_move_<Translation::BottomHead>(
-            target_data.bottom_letter, target_data.bottom_head_move,
-            data.bottom_letter, move_bottom_first, intermiediate);
-        program_look_for_head_<Translation::TopHead>(data.top_letter,
-                                                     intermiediate, found_top);
-        program_move_<Translation::TopHead>(
-            target_data.top_letter, target_data.top_head_move, data.top_letter,
-            found_top, state_aliases_[target_data.target_state].going_back);
+void Translation::erase_simulated_state_(const State &input_state_alias) {
+    /**
+     * A helper state is erased once the last transition leading to it is,
+     * so that the sub-machines still used by other simulated states stay
+     * (as with SHARE_SUBMACHINES). The states programmed here again lead
+     * only to their own helper states, which are not counted, and to the
+     * kept ones; helper states on a longer cycle would only be left behind
+     * unreachable, but the translation makes none.
+     */
+    std::vector<State> to_erase{input_state_alias};
+    while (!to_erase.empty()) {
+        const State state = std::move(to_erase.back());
+        to_erase.pop_back();
+
+        auto it = res_transitions_.lower_bound(
+            std::make_pair(state, std::vector<std::string>{}));
+        while (it != res_transitions_.end() && it->first.first == state) {
+            const State &next = std::get<0>(it->second);
+            if (next != state && !kept_.count(next) && !--references_[next]) {
+                to_erase.push_back(next);
+            }
+            it = res_transitions_.erase(it);
+        }
     }
 }
 
@@ -269,31 +530,34 @@ void Translation::program_reject_accept_(const SimulatedState &data,
 
 void Translation::program_cleanup_() {
     for (const auto &[old_state_ident, state_alias] : state_aliases_) {
-        assert(state_alias.going_back != "");
-        for (const auto &[key, letters_encoding] : letters_map_) {
-            new_transition_(state_alias.going_back, letters_encoding.no_head,
-                            state_alias.going_back, letters_encoding.no_head,
-                            HEAD_LEFT);
-
-            new_transition_(state_alias.going_back,
-                            letters_encoding.bottom_head,
-                            state_alias.going_back,
-                            letters_encoding.bottom_head, HEAD_LEFT);
-
-            new_transition_(state_alias.going_back, letters_encoding.top_head,
-                            state_alias.going_back, letters_encoding.top_head,
-                            HEAD_LEFT);
-            new_transition_(state_alias.going_back, letters_encoding.both_heads,
-                            state_alias.going_back, letters_encoding.both_heads,
-                            HEAD_LEFT);
-        }
+        program_going_back_(state_alias);
+    }
+}
 
-        // once we reach the begging of the tape, start scanning for letters
-        new_transition_(state_alias.going_back,
-                        importandt_idents_.letter_tape_start,
-                        state_alias.do_scanning,
-                        importandt_idents_.letter_tape_start, HEAD_RIGHT);
+void Translation::program_going_back_(const StateEncoding &state_alias) {
+    assert(state_alias.going_back != "");
+    for (const auto &[key, letters_encoding] : letters_map_) {
+        new_transition_(state_alias.going_back, letters_encoding.no_head,
+                        state_alias.going_back, letters_encoding.no_head,
+                        HEAD_LEFT);
+
+        new_transition_(state_alias.going_back, letters_encoding.bottom_head,
+                        state_alias.going_back, letters_encoding.bottom_head,
+                        HEAD_LEFT);
+
+        new_transition_(state_alias.going_back, letters_encoding.top_head,
+                        state_alias.going_back, letters_encoding.top_head,
+                        HEAD_LEFT);
+        new_transition_(state_alias.going_back, letters_encoding.both_heads,
+                        state_alias.going_back, letters_encoding.both_heads,
+                        HEAD_LEFT);
     }
+
+    // once we reach the begging of the tape, start scanning for letters
+    new_transition_(state_alias.going_back,
+                    importandt_idents_.letter_tape_start,
+                    state_alias.do_scanning,
+                    importandt_idents_.letter_tape_start, HEAD_RIGHT);
 }
 
 void Translation::new_transition_(const State &initial,
@@ -301,6 +565,12 @@ void Translation::new_transition_(const State &initial,
                                   const State &final,
                                   const std::string &new_letter,
                                   const char &head_move) {
+    if (store_) {
+        store_->add(initial, std::vector{old_letter}, final,
+                    std::vector{new_letter}, std::string{head_move});
+        return;
+    }
+
     const auto key = std::make_pair(initial, std::vector{old_letter});
 
     assert(res_transitions_.find(key) == res_transitions_.end());
@@ -315,33 +585,45 @@ Translation::create_or_get_simulated_state_alias_(const SimulatedState &key) {
     if (it == simulated_states_.end()) {
         const auto res = states_.generate("found_both_letters");
         simulated_states_[key] = res;
+        if (lazy_) {
+            pending_[res] = [this, key, res] {
+                program_simulated_state_(key, res);
+            };
+        }
         return res;
     } else {
         return it->second;
     }
 }
 
-TuringMachine Translation::result() {
-    return TuringMachine(1, input_.input_alphabet, res_transitions_);
+const transitions_t::mapped_type *
+Translation::find_lazily(const transitions_t::key_type &key) {
+    auto it = res_transitions_.find(key);
+    if (it == res_transitions_.end()) {
+        const auto pending_it = pending_.find(key.first);
+        if (pending_it != pending_.end()) {
+            const auto program = std::move(pending_it->second);
+            pending_.erase(pending_it);
+            program();
+            it = res_transitions_.find(key);
+        }
+    }
+    return it == res_transitions_.end() ? nullptr : &it->second;
 }
 
-int main(int argc, char *argv[]) {
-    std::string filename = argv[1];
-
-    if (argc != 2) {
-        std::cerr << "Expected one argument" << std::endl;
-        return 1;
-    }
+TuringMachine Translation::result() {
+    assert(!store_ && !lazy_);
+    AllocPhase phase("result");
+    return TuringMachine(1, input_alphabet_, std::move(res_transitions_));
+}
 
-    FILE *f = fopen(filename.c_str(), "r");
-    if (!f) {
-        std::cerr << "ERROR: File " << filename << " does not exist\n";
-        return 1;
+void Translation::save_result(std::ostream &output, unsigned threads) {
+    if (store_) {
+        AllocPhase phase("serialization");
+        store_->save_to_file(output, input_alphabet_);
+    } else {
+        const TuringMachine res = result();
+        AllocPhase phase("serialization");
+        res.save_to_file(output, threads);
     }
-
-    auto tm = read_tm_from_file(f);
-
-    Translation translation(tm);
-
-    std::cout << translation.result();
 }
@@ -1,9 +1,20 @@
+#ifndef __TRANSLATOR_H
+#define __TRANSLATOR_H
+
 #include <cassert>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "alphabet_classes.h"
 #include "symbol_set.h"
+#include "transition_store.h"
 #include "turing_machine.h"
 
 struct ImportantIdents {
@@ -60,13 +71,56 @@ class Translation {
         LettersMap;
 
   public:
-    Translation(const TuringMachine &intput);
+    enum Flags : unsigned {
+        // only the setup protocol is programmed by the constructor, the rest
+        // is programmed by find_lazily the first time a run needs it
+        LAZY = 1,
+        // simulated states moving the heads in the same way share the states
+        // doing it, instead of each programming its own
+        SHARE_SUBMACHINES = 2,
+        // letters interchangeable in every transition are translated as one,
+        // see compute_alphabet_classes
+        COMPRESS_ALPHABET = 4,
+    };
+
+    /**
+     * If store is given, the translated transitions are kept there instead of
+     * in memory, and the result can only be written with save_result
+     */
+    Translation(const TuringMachine &intput, TransitionStore *store = nullptr,
+                unsigned flags = 0);
+
+    /**
+     * Translates input reusing previous_output, the translation of
+     * previous_input: only the simulated states whose transitions differ
+     * between the two inputs are programmed again, all the other
+     * generated names stay as they were. Throws std::runtime_error if
+     * previous_output does not have the names this translation generates
+     */
+    Translation(const TuringMachine &input, const TuringMachine &previous_input,
+                TuringMachine previous_output);
+
+    // whether the incremental constructor can be used for those machines
+    static bool can_translate_incrementally(const TuringMachine &input,
+                                            const TuringMachine &previous_input);
+
+    /**
+     * Finds the translated transition from key, programming first the states
+     * it belongs to if they were not yet; nullptr if there is no transition
+     */
+    const transitions_t::mapped_type *
+    find_lazily(const transitions_t::key_type &key);
 
+    // moves the translated transitions out, so it can be taken only once
     TuringMachine result();
 
+    void save_result(std::ostream &output, unsigned threads = 1);
+
   private:
     class TopHead {
       public:
+        static constexpr bool is_top = true;
+
         static inline Translation::Letter
         this_other_not(const LetterEncoding &letter) {
             return letter.top_head;
@@ -85,6 +139,8 @@ class Translation {
 
     class BottomHead {
       public:
+        static constexpr bool is_top = false;
+
         static inline Translation::Letter
         this_other_not(const LetterEncoding &letter) {
             return letter.bottom_head;
@@ -124,8 +180,30 @@ class Translation {
      */
     void program_scanning_for_letters_();
 
+    void program_scanning_state_(const State &old_state_ident,
+                                 const State &do_scanning);
+
     void program_transitions_();
 
+    void program_simulated_state_(const SimulatedState &data,
+                                  const State &input_state_alias);
+
+    // leads from the simulated state to the states moving either head first
+    void program_moving_first_(const SimulatedState &data,
+                               const State &input_state_alias,
+                               const State &move_top_first,
+                               const State &move_bottom_first);
+
+    // in the incremental mode, checks the previous output was made with
+    // the same names, throwing std::runtime_error otherwise
+    void check_previous_output_() const;
+
+    /**
+     * Removes the transitions programmed for a simulated state,
+     * together with the helper states no other state leads to
+     */
+    void erase_simulated_state_(const State &input_state_alias);
+
     void program_reject_accept_(const SimulatedState &data,
                                 const State &in_staten, const State &target);
 
@@ -134,8 +212,33 @@ class Translation {
                        const char &target_head_move, const Letter &this_letter,
                        const State &in_state, const State &out_state);
 
+    // after the head was moved, marks it on the letter it is over
+    template <typename H>
+    void program_marking_head_(const char &target_head_move,
+                               const State &marking_this_head,
+                               const State &out_state);
+
+    /**
+     * Those return the in_state of a sub-machine, programming it only if no
+     * sub-machine with the same parameters was programmed yet
+     */
+    template <typename H>
+    State shared_move_(const Letter &target_letter,
+                       const char &target_head_move, const Letter &this_letter,
+                       const State &out_state);
+
+    template <typename H>
+    State shared_marking_head_(const char &target_head_move,
+                               const State &out_state);
+
+    template <typename H>
+    State shared_look_for_head_(const Letter &this_letter,
+                                const State &out_state);
+
     void program_cleanup_();
 
+    void program_going_back_(const StateEncoding &state_alias);
+
     /**
      * Goes left, until meeting the specified head
      */
@@ -147,6 +250,12 @@ class Translation {
     void program_scanning_letters_(const State &in_state,
                                    const State &old_state_ident);
 
+    // leads to the simulated state once the other head is found
+    template <typename H>
+    void program_found_first_letter_(const State &found_first_letter,
+                                     const Letter &first_letter,
+                                     const State &old_state_ident);
+
     inline void new_transition_(const State &initial,
                                 const std::string &old_letter,
                                 const State &final,
@@ -155,7 +264,17 @@ class Translation {
 
     State create_or_get_simulated_state_alias_(const SimulatedState &key);
 
+    const Letter &letter_class_(const Letter &letter) const {
+        return classes_ ? classes_->representative.at(letter) : letter;
+    }
+
+    // with COMPRESS_ALPHABET, the quotient which is translated instead
+    std::unique_ptr<AlphabetClasses> classes_;
     const TuringMachine &input_;
+    // the letters the translated machine reads, those of the given input
+    const std::vector<Letter> &input_alphabet_;
+    TransitionStore *store_;
+    bool lazy_, share_submachines_;
     SymbolSet states_, letters_;
     LettersMap letters_map_;
     ImportantIdents importandt_idents_;
@@ -165,6 +284,24 @@ class Translation {
         simulated_states_;
 
     transitions_t res_transitions_;
+
+    // in the incremental mode, the number of transitions of the previous
+    // output leading to each state from another one
+    std::unordered_map<State, size_t> references_;
+
+    // in the incremental mode, the states programmed for the simulated
+    // machine rather than for a single simulated state, never erased
+    std::unordered_set<State> kept_;
+
+    // in the lazy mode, what to program once a run reaches a state
+    std::unordered_map<State, std::function<void()>> pending_;
+
+    // the shared sub-machines by their parameters, the first being whether
+    // they are about the top head
+    std::map<std::tuple<bool, Letter, char, Letter, State>, State>
+        shared_moves_;
+    std::map<std::tuple<bool, char, State>, State> shared_marking_heads_;
+    std::map<std::tuple<bool, Letter, State>, State> shared_looks_for_head_;
 };
 
 template <typename H>
@@ -173,13 +310,12 @@ void Translation::program_move_(const Letter &target_letter,
                                 const Letter &this_letter,
                                 const State &in_state, const State &out_state) {
 
-    State marking_this_head = states_.generate("marking_head");
-
-    if (target_head_move == HEAD_RIGHT) {
-        new_transition_(
-            marking_this_head, BLANK, out_state,
-            H::this_other_not(letters_map_[std::make_pair(BLANK, BLANK)]),
-            HEAD_LEFT);
+    // a head which stays is not marked again, the shared moves skip it
+    State marking_this_head;
+    if (!share_submachines_) {
+        marking_this_head = states_.generate("marking_head");
+    } else if (target_head_move != HEAD_STAY) {
+        marking_this_head = shared_marking_head_<H>(target_head_move, out_state);
     }
 
     for (const Letter &other_letter : input_.working_alphabet()) {
@@ -210,6 +346,23 @@ void Translation::program_move_(const Letter &target_letter,
         }
     }
 
+    if (!share_submachines_) {
+        program_marking_head_<H>(target_head_move, marking_this_head,
+                                 out_state);
+    }
+}
+
+template <typename H>
+void Translation::program_marking_head_(const char &target_head_move,
+                                        const State &marking_this_head,
+                                        const State &out_state) {
+    if (target_head_move == HEAD_RIGHT) {
+        new_transition_(
+            marking_this_head, BLANK, out_state,
+            H::this_other_not(letters_map_[std::make_pair(BLANK, BLANK)]),
+            HEAD_LEFT);
+    }
+
     const auto return_move =
         target_head_move == HEAD_RIGHT ? HEAD_LEFT : HEAD_RIGHT;
     for (const auto &[letter_pair, letter_encoding] : letters_map_) {
@@ -221,6 +374,53 @@ void Translation::program_move_(const Letter &target_letter,
     }
 }
 
+template <typename H>
+Translation::State Translation::shared_move_(const Letter &target_letter,
+                                             const char &target_head_move,
+                                             const Letter &this_letter,
+                                             const State &out_state) {
+    const auto key = std::make_tuple(H::is_top, target_letter,
+                                     target_head_move, this_letter, out_state);
+    const auto it = shared_moves_.find(key);
+    if (it != shared_moves_.end()) {
+        return it->second;
+    }
+    const State in_state = states_.generate("move_head");
+    shared_moves_[key] = in_state;
+    program_move_<H>(target_letter, target_head_move, this_letter, in_state,
+                     out_state);
+    return in_state;
+}
+
+template <typename H>
+Translation::State
+Translation::shared_marking_head_(const char &target_head_move,
+                                  const State &out_state) {
+    const auto key = std::make_tuple(H::is_top, target_head_move, out_state);
+    const auto it = shared_marking_heads_.find(key);
+    if (it != shared_marking_heads_.end()) {
+        return it->second;
+    }
+    const State marking_this_head = states_.generate("marking_head");
+    shared_marking_heads_[key] = marking_this_head;
+    program_marking_head_<H>(target_head_move, marking_this_head, out_state);
+    return marking_this_head;
+}
+
+template <typename H>
+Translation::State Translation::shared_look_for_head_(const Letter &this_letter,
+                                                      const State &out_state) {
+    const auto key = std::make_tuple(H::is_top, this_letter, out_state);
+    const auto it = shared_looks_for_head_.find(key);
+    if (it != shared_looks_for_head_.end()) {
+        return it->second;
+    }
+    const State in_state = states_.generate("looking_for_head");
+    shared_looks_for_head_[key] = in_state;
+    program_look_for_head_<H>(this_letter, in_state, out_state);
+    return in_state;
+}
+
 template <typename H>
 void Translation::program_look_for_head_(const Letter &this_letter,
                                          const State &in_state,
@@ -260,31 +460,49 @@ void Translation::program_scanning_letters_(const State &in_state,
                             H::this_other_not(letter_encoding), HEAD_RIGHT);
         }
 
-        for (const auto &letter_without_head : input_.working_alphabet()) {
-            for (const auto &other_letter : input_.working_alphabet()) {
-
-                const auto letter_pair =
-                    H::make_pair(letter_without_head, other_letter);
-                const auto letter_encoding = letters_map_[letter_pair];
-
-                const auto found_letter_pair =
-                    H::make_pair(first_letter, other_letter);
-                new_transition_(found_first_letter, letter_encoding.no_head,
-                                found_first_letter, letter_encoding.no_head,
-                                HEAD_RIGHT);
-
-                const auto found_both_letters =
-                    create_or_get_simulated_state_alias_(SimulatedState{
-                        .state = old_state_ident,
-                        .top_letter = found_letter_pair.first,
-                        .bottom_letter = found_letter_pair.second,
-                    });
-
-                new_transition_(found_first_letter,
-                                H::other_this_not(letter_encoding),
-                                found_both_letters,
-                                H::other_this_not(letter_encoding), HEAD_STAY);
-            }
+        if (lazy_) {
+            pending_[found_first_letter] = [this, found_first_letter,
+                                            first_letter, old_state_ident] {
+                program_found_first_letter_<H>(found_first_letter,
+                                               first_letter, old_state_ident);
+            };
+        } else {
+            program_found_first_letter_<H>(found_first_letter, first_letter,
+                                           old_state_ident);
+        }
+    }
+}
+
+template <typename H>
+void Translation::program_found_first_letter_(
+    const State &found_first_letter, const Letter &first_letter,
+    const State &old_state_ident) {
+    for (const auto &letter_without_head : input_.working_alphabet()) {
+        for (const auto &other_letter : input_.working_alphabet()) {
+
+            const auto letter_pair =
+                H::make_pair(letter_without_head, other_letter);
+            const auto letter_encoding = letters_map_[letter_pair];
+
+            const auto found_letter_pair =
+                H::make_pair(first_letter, other_letter);
+            new_transition_(found_first_letter, letter_encoding.no_head,
+                            found_first_letter, letter_encoding.no_head,
+                            HEAD_RIGHT);
+
+            const auto found_both_letters =
+                create_or_get_simulated_state_alias_(SimulatedState{
+                    .state = old_state_ident,
+                    .top_letter = found_letter_pair.first,
+                    .bottom_letter = found_letter_pair.second,
+                });
+
+            new_transition_(found_first_letter,
+                            H::other_this_not(letter_encoding),
+                            found_both_letters,
+                            H::other_this_not(letter_encoding), HEAD_STAY);
         }
     }
 }
+
+#endif
@@ -0,0 +1,343 @@
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "alloc_stats.h"
+#include "binary_translator.h"
+#include "compact_names.h"
+#include "translation_cache.h"
+#include "translation_estimate.h"
+#include "translator.h"
+
+static void print_usage(const std::string &error) {
+    std::cerr << "ERROR: " << error << "\n"
+              << "Usage: translator [options] <input_file>\n"
+              << "Options:\n"
+              << "  --incremental <previous_input> <previous_output>\n"
+              << "      reuse the translation of a previous version of the "
+                 "machine\n"
+              << "  --cache-dir <directory>\n"
+              << "      reuse translations of the same machines\n"
+              << "  --compact-names\n"
+              << "      give the generated states and letters the shortest "
+                 "names\n"
+              << "  --share-submachines\n"
+              << "      let the simulated states moving the heads in the same "
+                 "way share\n"
+              << "      the states doing it\n"
+              << "  --compress-alphabet\n"
+              << "      translate the letters interchangeable in every "
+                 "transition as one\n"
+              << "  --binary-tracks\n"
+              << "      keep each simulated cell as a block of bits, for large "
+                 "alphabets\n"
+              << "  --names-map <file>\n"
+              << "      write the original names of the compacted ones\n"
+              << "  --memory-budget <bytes>\n"
+              << "      keep the translated transitions in a flat store, "
+                 "spilling them\n"
+              << "      to temporary files above the budget\n"
+              << "  --write-threads <n>\n"
+              << "      format the output with n threads\n"
+              << "  --estimate\n"
+              << "      only print the size of the translation and the memory "
+                 "it needs;\n"
+              << "      with --binary-tracks also the size in that mode, "
+                 "found by translating\n"
+              << "  --alloc-stats\n"
+              << "      print the allocations of each phase to stderr\n";
+    exit(1);
+}
+
+static TuringMachine read_machine(const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "r");
+    if (!f) {
+        std::cerr << "ERROR: File " << filename << " does not exist\n";
+        exit(1);
+    }
+    AllocPhase phase("parse");
+    return read_tm_from_file(f);
+}
+
+struct TranslatorOptions {
+    bool compact_names = false;
+
+    bool share_submachines = false;
+
+    bool compress_alphabet = false;
+
+    // BinaryTranslation instead of Translation
+    bool binary_tracks = false;
+
+    // 0 if the transitions are kept in memory
+    size_t memory_budget = 0;
+
+    // formatting the output, which does not change it
+    unsigned write_threads = 1;
+
+    // describes the options changing the output, for the cache key
+    // (the flat store does not change it)
+    std::string describe() const {
+        std::string res = compact_names ? "compact-names" : "";
+        if (share_submachines) {
+            res += res.empty() ? "share-submachines" : " share-submachines";
+        }
+        if (compress_alphabet) {
+            res += res.empty() ? "compress-alphabet" : " compress-alphabet";
+        }
+        if (binary_tracks) {
+            res += res.empty() ? "binary-tracks" : " binary-tracks";
+        }
+        return res;
+    }
+
+    unsigned translation_flags() const {
+        unsigned res = 0;
+        if (share_submachines) {
+            res |= Translation::SHARE_SUBMACHINES;
+        }
+        if (compress_alphabet) {
+            res |= Translation::COMPRESS_ALPHABET;
+        }
+        return res;
+    }
+};
+
+// writes the translation, and the map of the compacted names if names is set
+static void translate(const TuringMachine &tm, const TranslatorOptions &options,
+                      std::ostream &output, std::ostream *names) {
+    if (options.memory_budget) {
+        TransitionStore store(1, options.memory_budget);
+        AllocPhase translating("translation");
+        Translation translation(tm, &store, options.translation_flags());
+        translating.end();
+        translation.save_result(output);
+        return;
+    }
+
+    if (options.binary_tracks) {
+        AllocPhase translating("translation");
+        BinaryTranslation translation(tm);
+        translating.end();
+        TuringMachine res = translation.result();
+        if (options.compact_names) {
+            AllocPhase compacting("compact names");
+            res = compact_names(res, names);
+        }
+        AllocPhase phase("serialization");
+        res.save_to_file(output, options.write_threads);
+        return;
+    }
+
+    AllocPhase translating("translation");
+    Translation translation(tm, nullptr, options.translation_flags());
+    translating.end();
+    if (options.compact_names) {
+        AllocPhase compacting("compact names");
+        const TuringMachine compacted =
+            compact_names(translation.result(), names);
+        compacting.end();
+        AllocPhase phase("serialization");
+        compacted.save_to_file(output, options.write_threads);
+    } else {
+        translation.save_result(output, options.write_threads);
+    }
+}
+
+static void translate_cached(const TuringMachine &tm,
+                             const TranslatorOptions &options,
+                             const std::string &cache_directory,
+                             std::ostream *names) {
+    TranslationCache cache(cache_directory);
+    const std::string key = TranslationCache::key(tm, options.describe());
+    const std::string names_key =
+        TranslationCache::key(tm, options.describe() + " names-map");
+
+    if (!cache.load(key, std::cout)) {
+        std::string names_map;
+        const bool stored = cache.store(key, [&](std::ostream &output) {
+            std::ostringstream map;
+            translate(tm, options, output,
+                      options.compact_names ? &map : nullptr);
+            names_map = map.str();
+        });
+        // if it fails, the names are translated again once asked for
+        if (stored && options.compact_names) {
+            cache.store(names_key,
+                        [&](std::ostream &output) { output << names_map; });
+        }
+        if (!stored || !cache.load(key, std::cout)) {
+            std::cerr << "WARNING: Cannot write to the cache in "
+                      << cache_directory << ", translating without it\n";
+            translate(tm, options, std::cout, names);
+            return;
+        }
+    }
+
+    if (names && !cache.load(names_key, *names)) {
+        std::ostringstream ignored;
+        translate(tm, options, ignored, names);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string filename, previous_input_name, previous_output_name;
+    std::string cache_directory, names_filename;
+    bool incremental = false, estimate = false;
+    TranslatorOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--incremental") {
+            if (i + 2 >= argc) {
+                print_usage("Two files expected after --incremental");
+            }
+            incremental = true;
+            previous_input_name = argv[++i];
+            previous_output_name = argv[++i];
+        } else if (arg == "--cache-dir") {
+            if (i + 1 >= argc) {
+                print_usage("A directory expected after --cache-dir");
+            }
+            cache_directory = argv[++i];
+        } else if (arg == "--compact-names") {
+            options.compact_names = true;
+        } else if (arg == "--share-submachines") {
+            options.share_submachines = true;
+        } else if (arg == "--binary-tracks") {
+            options.binary_tracks = true;
+        } else if (arg == "--compress-alphabet") {
+            options.compress_alphabet = true;
+        } else if (arg == "--names-map") {
+            if (i + 1 >= argc) {
+                print_usage("A file expected after --names-map");
+            }
+            names_filename = argv[++i];
+        } else if (arg == "--memory-budget") {
+            try {
+                if (i + 1 >= argc) {
+                    throw 0;
+                }
+                const std::string budget = argv[++i];
+                size_t last;
+                options.memory_budget = std::stoull(budget, &last);
+                if (last != budget.length() || budget[0] == '-' ||
+                    !options.memory_budget) {
+                    throw 0;
+                }
+            } catch (...) {
+                print_usage("A positive number expected after --memory-budget");
+            }
+        } else if (arg == "--write-threads") {
+            try {
+                if (i + 1 >= argc) {
+                    throw 0;
+                }
+                const std::string threads = argv[++i];
+                size_t last;
+                options.write_threads = std::stoul(threads, &last);
+                if (last != threads.length() || threads[0] == '-' ||
+                    !options.write_threads) {
+                    throw 0;
+                }
+            } catch (...) {
+                print_usage("A positive number expected after --write-threads");
+            }
+        } else if (arg == "--estimate") {
+            estimate = true;
+        } else if (arg == "--alloc-stats") {
+            enable_alloc_stats();
+        } else if (filename.empty()) {
+            filename = arg;
+        } else {
+            print_usage("Too many arguments");
+        }
+    }
+    if (filename.empty()) {
+        print_usage("Expected an input file");
+    }
+    if (!names_filename.empty() && !options.compact_names) {
+        print_usage("--names-map requires --compact-names");
+    }
+    if (options.memory_budget && options.compact_names) {
+        print_usage("--compact-names cannot be used with --memory-budget");
+    }
+    if (incremental && options.compact_names) {
+        // the previous output is looked up by the descriptive names
+        print_usage("--incremental cannot be used with --compact-names");
+    }
+    if (options.share_submachines && (incremental || estimate)) {
+        // both rely on each simulated state having its own helper states
+        print_usage("--share-submachines cannot be used with --incremental "
+                    "or --estimate");
+    }
+    if (options.binary_tracks &&
+        (incremental || options.share_submachines ||
+         options.compress_alphabet || options.memory_budget)) {
+        // those are about the letters encoding pairs of letters
+        print_usage("--binary-tracks cannot be used with --incremental, "
+                    "--share-submachines, --compress-alphabet or "
+                    "--memory-budget");
+    }
+    if (options.compress_alphabet && (incremental || estimate)) {
+        // the previous output and the estimate are over the whole alphabet
+        print_usage("--compress-alphabet cannot be used with --incremental "
+                    "or --estimate");
+    }
+
+    auto tm = read_machine(filename);
+    if (tm.num_tapes != 2) {
+        std::cerr << "ERROR: Only 2-tape machines can be translated\n";
+        return 1;
+    }
+
+    if (estimate) {
+        std::cout << estimate_translation(tm);
+        if (options.binary_tracks) {
+            // both modes, to compare the size against the cost of a step
+            print_estimate(std::cout, estimate_binary_translation(tm),
+                           "binary-tracks-");
+        }
+        return 0;
+    }
+
+    if (incremental) {
+        const auto previous_input = read_machine(previous_input_name);
+        if (Translation::can_translate_incrementally(tm, previous_input)) {
+            try {
+                Translation translation(tm, previous_input,
+                                        read_machine(previous_output_name));
+                translation.save_result(std::cout, options.write_threads);
+            } catch (const std::runtime_error &error) {
+                std::cerr << "ERROR: " << error.what() << "\n";
+                return 1;
+            }
+            return 0;
+        }
+        std::cerr << "The states or letters of the machine have changed, "
+                     "translating it from scratch\n";
+    }
+
+    std::ofstream names_file;
+    if (!names_filename.empty()) {
+        names_file.open(names_filename);
+        if (!names_file) {
+            std::cerr << "ERROR: Cannot write to " << names_filename << "\n";
+            return 1;
+        }
+    }
+    std::ostream *names = names_file.is_open() ? &names_file : nullptr;
+
+    // the store spills its runs to temporary files, which may fail
+    try {
+        if (!cache_directory.empty()) {
+            translate_cached(tm, options, cache_directory, names);
+        } else {
+            translate(tm, options, std::cout, names);
+        }
+    } catch (const std::runtime_error &error) {
+        std::cout.flush();
+        std::cerr << "ERROR: " << error.what() << "\n";
+        return 1;
+    }
+}
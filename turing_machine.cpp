@@ -6,6 +6,7 @@
 #include <iostream>
 #include <set>
 #include <string>
+#include <thread>
 
 using namespace std;
 
@@ -79,7 +80,7 @@ static bool is_direction(int ch) {
 // searches for an identifier starting from position pos;
 // at the end pos is the position after the identifier
 // (if false returned, pos remains unchanged)
-static bool check_identifier(string ident, size_t &pos) {
+static bool check_identifier(const string &ident, size_t &pos) {
     if (pos >= ident.size())
         return false;
     if (is_valid_char(ident[pos])) {
@@ -97,27 +98,27 @@ static bool check_identifier(string ident, size_t &pos) {
     return true;
 }
 
-static bool is_identifier(string ident) {
+static bool is_identifier(const string &ident) {
     size_t pos = 0;
     return check_identifier(ident, pos) && pos == ident.length();
 }
 
-TuringMachine::TuringMachine(int num_tapes_, vector<string> input_alphabet_,
-                             transitions_t transitions_)
-    : num_tapes(num_tapes_), input_alphabet(input_alphabet_),
-      transitions(transitions_) {
+TuringMachine::TuringMachine(int num_tapes_, vector<string> input_alphabet,
+                             transitions_t transitions)
+    : num_tapes(num_tapes_), input_alphabet_(move(input_alphabet)),
+      transitions_(move(transitions)) {
     assert(num_tapes > 0);
-    assert(!input_alphabet.empty());
-    for (auto letter : input_alphabet)
+    assert(!input_alphabet_.empty());
+    for (const auto &letter : input_alphabet_)
         assert(is_identifier(letter) && letter != BLANK);
-    for (auto transition : transitions) {
-        auto state_before = transition.first.first;
-        auto letters_before = transition.first.second;
-        auto state_after = get<0>(transition.second);
-        auto letters_after = get<1>(transition.second);
-        auto directions = get<2>(transition.second);
-        // assert(is_identifier(state_before) && state_before != ACCEPTING_STATE
-        // && state_before != REJECTING_STATE && is_identifier(state_after));
+    for (const auto &transition : transitions_) {
+        const auto &letters_before = transition.first.second;
+        const auto &letters_after = get<1>(transition.second);
+        const auto &directions = get<2>(transition.second);
+        // assert(is_identifier(transition.first.first) &&
+        // transition.first.first != ACCEPTING_STATE &&
+        // transition.first.first != REJECTING_STATE &&
+        // is_identifier(get<0>(transition.second)));
         assert(letters_before.size() == (size_t)num_tapes &&
                letters_after.size() == (size_t)num_tapes &&
                directions.length() == (size_t)num_tapes);
@@ -148,7 +149,10 @@ static string read_identifier(Reader &reader) {
 #define NUM_TAPES "num-tapes:"
 #define INPUT_ALPHABET "input-alphabet:"
 
-TuringMachine read_tm_from_file(FILE *input) {
+// reads the header of a machine and then its transitions, passing each of them
+// to add_transition, which returns false if the transition is not allowed
+template <typename F>
+static pair<int, vector<string>> read_machine(FILE *input, F add_transition) {
     Reader reader(input);
 
     // number of tapes
@@ -187,7 +191,6 @@ TuringMachine read_tm_from_file(FILE *input) {
     reader.go_to_next_line();
 
     // transitions
-    transitions_t transitions;
     while (reader.is_next_token_available()) {
         string state_before = read_identifier(reader);
         if (state_before == "(accept)" || state_before == "(reject)")
@@ -198,10 +201,6 @@ TuringMachine read_tm_from_file(FILE *input) {
         for (int a = 0; a < num_tapes; ++a)
             letters_before.emplace_back(read_identifier(reader));
 
-        if (transitions.find(make_pair(state_before, letters_before)) !=
-            transitions.end())
-            syntax_error(reader, "The machine is not deterministic");
-
         string state_after = read_identifier(reader);
 
         vector<string> letters_after;
@@ -222,61 +221,192 @@ TuringMachine read_tm_from_file(FILE *input) {
 
         if (reader.is_next_token_available())
             syntax_error(reader, "Too many tokens in a line");
-        reader.go_to_next_line();
 
-        transitions[make_pair(state_before, letters_before)] =
-            make_tuple(state_after, letters_after, directions);
+        if (!add_transition(make_pair(state_before, letters_before),
+                            make_tuple(state_after, letters_after, directions)))
+            syntax_error(reader, "The machine is not deterministic");
+        reader.go_to_next_line();
     }
 
-    return TuringMachine(num_tapes, input_alphabet, transitions);
+    return make_pair(num_tapes, input_alphabet);
 }
 
-vector<string> TuringMachine::working_alphabet() const {
+TuringMachine read_tm_from_file(FILE *input) {
+    transitions_t transitions;
+    auto header = read_machine(
+        input, [&](transitions_t::key_type key, transitions_t::mapped_type target) {
+            return transitions.emplace(move(key), move(target)).second;
+        });
+    return TuringMachine(header.first, move(header.second), move(transitions));
+}
+
+TuringMachine read_tm_from_file(
+    FILE *input,
+    const function<bool(transitions_t::key_type, transitions_t::mapped_type)>
+        &add_transition) {
+    auto header = read_machine(input, add_transition);
+    return TuringMachine(header.first, move(header.second), transitions_t());
+}
+
+NondeterministicTuringMachine read_ntm_from_file(FILE *input) {
+    nondeterministic_transitions_t transitions;
+    auto header = read_machine(
+        input, [&](transitions_t::key_type key, transitions_t::mapped_type target) {
+            auto range = transitions.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it)
+                if (it->second == target)
+                    return true; // the same choice listed twice
+            transitions.emplace(move(key), move(target));
+            return true;
+        });
+    return NondeterministicTuringMachine{header.first, move(header.second),
+                                         move(transitions)};
+}
+
+const TuringMachineIndex &
+TuringMachineIndexCache::find_or_build(const vector<string> &input_alphabet,
+                             const transitions_t &transitions) const {
+    const TuringMachineIndex *index = index_.load();
+    if (index)
+        return *index;
+    lock_guard<mutex> guard(lock_);
+    index = index_.load();
+    if (index)
+        return *index;
+
     set<string> letters(input_alphabet.begin(), input_alphabet.end());
     letters.insert(BLANK);
-    for (auto transition : transitions) {
-        auto letters_before = transition.first.second;
-        auto letters_after = get<1>(transition.second);
-        letters.insert(letters_before.begin(), letters_before.end());
-        letters.insert(letters_after.begin(), letters_after.end());
+    set<string> states{INITIAL_STATE, ACCEPTING_STATE, REJECTING_STATE};
+    for (const auto &[key, target] : transitions) {
+        states.insert(key.first);
+        states.insert(get<0>(target));
+        letters.insert(key.second.begin(), key.second.end());
+        letters.insert(get<1>(target).begin(), get<1>(target).end());
+    }
+
+    auto res = new TuringMachineIndex;
+    res->working_alphabet.assign(letters.begin(), letters.end());
+    res->states.assign(states.begin(), states.end());
+    for (size_t a = 0; a < res->working_alphabet.size(); ++a)
+        res->letter_ids[res->working_alphabet[a]] = a;
+    for (size_t a = 0; a < res->states.size(); ++a)
+        res->state_ids[res->states[a]] = a;
+
+    // the map is sorted by the states first
+    res->state_transitions.assign(
+        res->states.size(), make_pair(transitions.end(), transitions.end()));
+    for (auto it = transitions.begin(); it != transitions.end();) {
+        auto &range = res->state_transitions[res->state_ids[it->first.first]];
+        range.first = it;
+        while (it != transitions.end() && it->first.first == range.first->first.first)
+            ++it;
+        range.second = it;
+    }
+
+    index_.store(res);
+    return *res;
+}
+
+void TuringMachine::set_transition(const transitions_t::key_type &key,
+                                   const transitions_t::mapped_type &target) {
+    index_.reset();
+    transitions_[key] = target;
+}
+
+void TuringMachine::erase_transition(const transitions_t::key_type &key) {
+    index_.reset();
+    transitions_.erase(key);
+}
+
+transitions_t TuringMachine::take_transitions() {
+    index_.reset();
+    return move(transitions_);
+}
+
+// the output is written in pieces of about this many bytes
+#define SAVE_BUFFER (1 << 20)
+// transitions formatted at once by one thread
+#define SAVE_CHUNK 16384
+
+static void append_vector(string &buffer, const vector<string> &v) {
+    for (const string &el : v) {
+        buffer += ' ';
+        buffer += el;
     }
-    return vector<string>(letters.begin(), letters.end());
 }
 
-vector<string> TuringMachine::set_of_states() const {
-    set<string> states;
-    states.insert(INITIAL_STATE);
-    states.insert(ACCEPTING_STATE);
-    states.insert(REJECTING_STATE);
-    for (auto transition : transitions) {
-        states.insert(transition.first.first);
-        states.insert(get<0>(transition.second));
+static void append_transition(string &buffer,
+                              const transitions_t::value_type &transition,
+                              int num_tapes) {
+    buffer += transition.first.first;
+    append_vector(buffer, transition.first.second);
+    buffer += ' ';
+    buffer += get<0>(transition.second);
+    append_vector(buffer, get<1>(transition.second));
+    const string &directions = get<2>(transition.second);
+    for (int a = 0; a < num_tapes; ++a) {
+        buffer += ' ';
+        buffer += directions[a];
     }
-    return vector<string>(states.begin(), states.end());
+    buffer += '\n';
 }
 
-static void output_vector(ostream &output, vector<string> v) {
-    for (string el : v)
-        output << " " << el;
+static void write_buffer(ostream &output, string &buffer) {
+    output.write(buffer.data(), buffer.length());
+    buffer.clear();
 }
 
-void TuringMachine::save_to_file(ostream &output) const {
-    output << NUM_TAPES << " " << num_tapes << "\n" << INPUT_ALPHABET;
-    output_vector(output, input_alphabet);
-    output << "\n";
-    for (auto transition : transitions) {
-        output << transition.first.first;
-        output_vector(output, transition.first.second);
-        output << " " << get<0>(transition.second);
-        output_vector(output, get<1>(transition.second));
-        string directions = get<2>(transition.second);
-        for (int a = 0; a < num_tapes; ++a)
-            output << " " << directions[a];
-        output << "\n";
+void TuringMachine::save_to_file(ostream &output, unsigned threads) const {
+    // the buffers keep their capacity, so nothing is allocated per transition
+    string buffer;
+    buffer.reserve(SAVE_BUFFER);
+    buffer += NUM_TAPES;
+    buffer += ' ';
+    buffer += to_string(num_tapes);
+    buffer += '\n';
+    buffer += INPUT_ALPHABET;
+    append_vector(buffer, input_alphabet_);
+    buffer += '\n';
+
+    if (threads <= 1) {
+        for (const auto &transition : transitions_) {
+            append_transition(buffer, transition, num_tapes);
+            if (buffer.length() >= SAVE_BUFFER)
+                write_buffer(output, buffer);
+        }
+        write_buffer(output, buffer);
+        return;
+    }
+    write_buffer(output, buffer);
+
+    vector<transitions_t::const_iterator> bounds;
+    size_t count = 0;
+    for (auto it = transitions_.begin(); it != transitions_.end(); ++it, ++count)
+        if (count % SAVE_CHUNK == 0)
+            bounds.push_back(it);
+    bounds.push_back(transitions_.end());
+
+    // each round formats a chunk per thread, then writes them in order
+    vector<string> buffers(threads);
+    for (size_t first = 0; first + 1 < bounds.size(); first += threads) {
+        size_t chunks = min<size_t>(threads, bounds.size() - 1 - first);
+        auto format = [&](size_t a) {
+            for (auto it = bounds[first + a]; it != bounds[first + a + 1]; ++it)
+                append_transition(buffers[a], *it, num_tapes);
+        };
+        vector<thread> workers;
+        for (size_t a = 1; a < chunks; ++a)
+            workers.emplace_back(format, a);
+        format(0);
+        for (auto &worker : workers)
+            worker.join();
+        for (size_t a = 0; a < chunks; ++a)
+            write_buffer(output, buffers[a]);
     }
 }
 
-vector<string> TuringMachine::parse_input(std::string input) const {
+static vector<string> parse_word(const vector<string> &input_alphabet,
+                                 const string &input) {
     set<string> alphabet(input_alphabet.begin(), input_alphabet.end());
     size_t pos = 0;
     vector<string> res;
@@ -290,3 +420,12 @@ vector<string> TuringMachine::parse_input(std::string input) const {
     }
     return res;
 }
+
+vector<string> TuringMachine::parse_input(std::string input) const {
+    return parse_word(input_alphabet_, input);
+}
+
+vector<string>
+NondeterministicTuringMachine::parse_input(const std::string &input) const {
+    return parse_word(input_alphabet, input);
+}
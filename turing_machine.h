@@ -1,11 +1,16 @@
 #ifndef __TURING_MACHINE_H
 #define __TURING_MACHINE_H
 
+#include <atomic>
+#include <cstdint>
 #include <cstdio>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -27,25 +32,87 @@
 
 typedef std::map<std::pair<std::string, std::vector<std::string>>, std::tuple<std::string, std::vector<std::string>, std::string>> transitions_t;
 
+// what is known of a machine by walking all its transitions
+struct TuringMachineIndex {
+    // sorted, with the blank and the input alphabet
+    std::vector<std::string> working_alphabet;
+
+    // sorted, with the initial, accepting and rejecting states
+    std::vector<std::string> states;
+
+    // positions in the above
+    std::unordered_map<std::string, uint32_t> letter_ids, state_ids;
+
+    // by the state ids, the transitions from each state (a range of the map)
+    std::vector<std::pair<transitions_t::const_iterator,
+                          transitions_t::const_iterator>> state_transitions;
+};
+
+// holds the index of one machine; a copy holds nothing, as the index refers
+// to the transitions of the machine it was built for
+class TuringMachineIndexCache {
+  public:
+    TuringMachineIndexCache() : index_(nullptr) {}
+
+    TuringMachineIndexCache(const TuringMachineIndexCache &) : index_(nullptr) {}
+
+    TuringMachineIndexCache &operator=(const TuringMachineIndexCache &) {
+        reset();
+        return *this;
+    }
+
+    ~TuringMachineIndexCache() { reset(); }
+
+    // builds the index for transitions unless it is built already;
+    // safe to call from many threads
+    const TuringMachineIndex &find_or_build(const std::vector<std::string> &input_alphabet,
+                                  const transitions_t &transitions) const;
+
+    void reset() { delete index_.exchange(nullptr); }
+
+  private:
+    mutable std::mutex lock_;
+    mutable std::atomic<const TuringMachineIndex *> index_;
+};
+
 struct TuringMachine {
     int num_tapes;
     
-    std::vector<std::string> input_alphabet;
-    
-    transitions_t transitions;
+    TuringMachine(int, std::vector<std::string>, transitions_t);
+
+    const std::vector<std::string> &input_alphabet() const { return input_alphabet_; }
+
     // (state, [letter_on_tape_1, ..., letter_on_tape_k])
     //    -> (new_state, [new_letter_on_tape_1, ..., new_letter_on_tape_k], [move_on_tape_1, ..., move_on_tape_k])
-    
-    TuringMachine(int, std::vector<std::string>, transitions_t);
+    const transitions_t &transitions() const { return transitions_; }
+
+    // the transitions can only be changed through those, which drop the index
+    void set_transition(const transitions_t::key_type &key, const transitions_t::mapped_type &target);
+
+    void erase_transition(const transitions_t::key_type &key);
+
+    // moves the transitions out, leaving none
+    transitions_t take_transitions();
+
+    // built at the first use, and kept until the transitions change
+    const TuringMachineIndex &index() const { return index_.find_or_build(input_alphabet_, transitions_); }
 
-    std::vector<std::string> working_alphabet() const;
+    const std::vector<std::string> &working_alphabet() const { return index().working_alphabet; }
     
-    std::vector<std::string> set_of_states() const;
+    const std::vector<std::string> &set_of_states() const { return index().states; }
     
-    void save_to_file(std::ostream &output) const;
+    // formats into large buffers, with that many threads at once
+    void save_to_file(std::ostream &output, unsigned threads = 1) const;
     
     std::vector<std::string> parse_input(std::string input) const;
     // ERROR <=> input!="" && returned_value.empty()
+
+  private:
+    std::vector<std::string> input_alphabet_;
+
+    transitions_t transitions_;
+
+    TuringMachineIndexCache index_;
 };
 
 static inline std::ostream &operator<<(std::ostream &output, const TuringMachine &tm) {
@@ -55,4 +122,28 @@ static inline std::ostream &operator<<(std::ostream &output, const TuringMachine
 
 TuringMachine read_tm_from_file(FILE *input);
 
+// passes each transition to add_transition, which returns false if it is not
+// allowed, instead of keeping it: the machine returned has no transitions
+TuringMachine read_tm_from_file(
+    FILE *input,
+    const std::function<bool(transitions_t::key_type, transitions_t::mapped_type)>
+        &add_transition);
+
+// the same transition may lead to several choices (tried in every possible way)
+typedef std::multimap<transitions_t::key_type, transitions_t::mapped_type> nondeterministic_transitions_t;
+
+struct NondeterministicTuringMachine {
+    int num_tapes;
+
+    std::vector<std::string> input_alphabet;
+
+    nondeterministic_transitions_t transitions;
+
+    std::vector<std::string> parse_input(const std::string &input) const;
+    // ERROR <=> input!="" && returned_value.empty()
+};
+
+// unlike read_tm_from_file accepts many transitions from the same (state, letters)
+NondeterministicTuringMachine read_ntm_from_file(FILE *input);
+
 #endif